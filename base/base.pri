@@ -1,2 +1,3 @@
 INCLUDEPATH += $$PWD
 LIBS += -lbase -L$$PWD
+exists($$PWD/chess/gentables.cpp): DEFINES += LIVIUS_GENTABLES
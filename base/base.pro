@@ -21,6 +21,8 @@ SOURCES += \
     chess/magic.cpp \
     chess/board.cpp \
     pgn/pgn.cpp \
+    pgn/pgnbinary.cpp \
+    pgn/pgnindexcache.cpp \
     chess/chess.cpp \
     config/token.cpp \
     config/config.cpp \
@@ -30,6 +32,12 @@ SOURCES += \
     core/apppath.cpp \
     pgn/pgnhighlight.cpp
 
+# precomputed tables generated by make gentables
+exists(chess/gentables.cpp) {
+    DEFINES += LIVIUS_GENTABLES
+    SOURCES += chess/gentables.cpp
+}
+
 HEADERS += \
     chess/zobrist.h \
     chess/tables.h \
@@ -40,6 +48,8 @@ HEADERS += \
     chess/chess.h \
     chess/board.h \
     pgn/pgn.h \
+    pgn/pgnbinary.h \
+    pgn/pgnindexcache.h \
     sig/slotbase.h \
     sig/slot11.h \
     sig/slot.h \
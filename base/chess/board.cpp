@@ -149,10 +149,14 @@ void Board::reset()
 	update();
 }
 
-// recompute hash (debug)
-Signature Board::recomputeHash() const
+// compute hash from scratch using low or high key set
+Signature Board::computeHash( bool hi ) const
 {
-	Signature h = bturn == ctWhite ? 0 : Zobrist::turn;
+	const Signature (*pieceKeys)[ ptMax ][ 64 ] = hi ? Zobrist::pieceHi : Zobrist::piece;
+	const Signature (*castKeys)[ 0x88+1 ] = hi ? Zobrist::castHi : Zobrist::cast;
+	const Signature *epKeys = hi ? Zobrist::epFileHi : Zobrist::epFile;
+
+	Signature h = bturn == ctWhite ? 0 : (hi ? Zobrist::turnHi : Zobrist::turn);
 
 	// pieces
 	for (Color c = ctWhite; c <= ctBlack; c++ )
@@ -160,14 +164,14 @@ Signature Board::recomputeHash() const
 		{
 			Bitboard tmp = pieces( c, p );
 			while ( tmp )
-				h ^= Zobrist::piece[ c ][ p ][ BitOp::popBit(tmp) ];
+				h ^= pieceKeys[ c ][ p ][ BitOp::popBit(tmp) ];
 		}
 
 	// king
 	for ( Color c = ctWhite; c <= ctBlack; c++ )
 	{
 		Square kp = king(c);
-		h ^= Zobrist::piece[ c ][ ptKing ][ kp ];
+		h ^= pieceKeys[ c ][ ptKing ][ kp ];
 	}
 
 	// validate ep square
@@ -175,14 +179,20 @@ Signature Board::recomputeHash() const
 
 	// en passant
 	if ( bep )
-		h ^= Zobrist::epFile[ SquarePack::file( epSquare() ) ];
+		h ^= epKeys[ SquarePack::file( epSquare() ) ];
 
 	// castling rights
 	for ( Color c = ctWhite; c <= ctBlack; c++ )
-		h ^= Zobrist::cast[ c ][ castRights(c) ];
+		h ^= castKeys[ c ][ castRights(c) ];
 	return h;
 }
 
+// recompute hash (debug)
+Signature Board::recomputeHash() const
+{
+	return computeHash( 0 );
+}
+
 // recompute pawn hash (debug)
 Signature Board::recomputePawnHash() const
 {
@@ -271,6 +281,9 @@ void Board::update()
 
 	bhash = h;
 	bpawnHash = ph;
+#ifdef USE_SIG128
+	bhashHi = computeHash( 1 );
+#endif
 
 	// finally set frc flag
 	frc = 0;
@@ -610,6 +623,100 @@ std::string Board::toFEN() const
 	return buf;
 }
 
+
+// pack position (fails only if more than 32 pieces on board)
+bool Board::pack( PackedBoard &pb ) const
+{
+	memset( &pb, 0, sizeof(pb) );
+	Bitboard occ = occupied();
+	if ( BitOp::popCount( occ ) > 32 )
+		return 0;
+	pb.occ = occ;
+	for ( uint i = 0; occ; i++ )
+	{
+		Square sq = BitOp::popBit( occ );
+		pb.pieces[ i >> 1 ] |= (u8)(bpieces[ sq ] << ((i & 1) * 4));
+	}
+	pb.turnEp = (u8)((bturn << 7) | bep);
+	pb.fifty = bfifty;
+	pb.castRights[ ctWhite ] = bcastRights[ ctWhite ];
+	pb.castRights[ ctBlack ] = bcastRights[ ctBlack ];
+	pb.move = (u16)(curMove > 65535 ? 65535 : curMove);
+	pb.flags = (u8)((frc ? PackedBoard::pfFRC : 0) | (arenaMode ? PackedBoard::pfArena : 0));
+	return 1;
+}
+
+// unpack position
+bool Board::unpack( const PackedBoard &pb )
+{
+	clear();
+	Bitboard occ = pb.occ;
+	if ( BitOp::popCount( occ ) > 32 )
+		return 0;
+	uint kings[2] = { 0, 0 };
+	for ( uint i = 0; occ; i++ )
+	{
+		Square sq = BitOp::popBit( occ );
+		Piece p = (Piece)((pb.pieces[ i >> 1 ] >> ((i & 1) * 4)) & 15);
+		Piece pt = p & pmType;
+		Color c = (Color)(p >> psColor);
+		if ( pt == ptNone || pt > ptKing )
+			return 0;
+		Bitboard msk = BitOp::oneShl( sq );
+		bb[ bbiWOcc + c ] |= msk;
+		if ( pt == ptKing )
+		{
+			bkingPos[ c ] = sq;
+			kings[ c ]++;
+			continue;
+		}
+		bb[ BBI( c, pt ) ] |= msk;
+	}
+	if ( kings[ ctWhite ] != 1 || kings[ ctBlack ] != 1 )
+		return 0;
+	if ( (bb[ BBI( ctWhite, ptPawn ) ] | bb[ BBI( ctBlack, ptPawn ) ]) & pawnPromoSquares )
+		return 0;
+	bturn = (Color)(pb.turnEp >> 7);
+	bep = (Square)(pb.turnEp & 127);
+	if ( bep > 63 )
+		return 0;
+	if ( bep )
+	{
+		// ep square must be empty with opponent pawn in front of it
+		Bitboard epbb = BitOp::oneShl( bep );
+		if ( ((bb[ bbiWOcc ] | bb[ bbiBOcc ]) & epbb) ||
+			!(BitOp::shiftBackward( bturn, epbb ) & bb[ BBI( flip( bturn ), ptPawn ) ]) )
+			return 0;
+	}
+	bfifty = pb.fifty;
+	bcastRights[ ctWhite ] = pb.castRights[ ctWhite ];
+	bcastRights[ ctBlack ] = pb.castRights[ ctBlack ];
+	// castling rights must match king/rook placement (castling movegen relies on it)
+	for ( Color c = ctWhite; c <= ctBlack; c++ )
+	{
+		CastRights cr = bcastRights[ c ];
+		if ( !cr )
+			continue;
+		Square kp = king( c );
+		if ( SquarePack::relRank( c, kp ) != RANK1 )
+			return 0;
+		File kf = SquarePack::file( kp );
+		Bitboard rooks = bb[ BBI( c, ptRook ) ];
+		if ( CastPack::allowedShort( cr ) && ( CastPack::shortFile( cr ) <= kf || CastPack::shortFile( cr ) > HFILE ||
+			!(rooks & BitOp::oneShl( SquarePack::setFile( kp, CastPack::shortFile( cr ) ) )) ) )
+			return 0;
+		if ( CastPack::allowedLong( cr ) && ( CastPack::longFile( cr ) >= kf ||
+			!(rooks & BitOp::oneShl( SquarePack::setFile( kp, CastPack::longFile( cr ) ) )) ) )
+			return 0;
+	}
+	curMove = pb.move ? pb.move : 1;
+	arenaMode = (pb.flags & PackedBoard::pfArena) != 0;
+	update();
+	// update derives frc from castling rights only
+	frc = (pb.flags & PackedBoard::pfFRC) != 0;
+	return !doesAttack<1>( turn(), king( flip(turn()) ) );
+}
+
 char *Board::toFEN( char *dst ) const
 {
 	uint count = 0;					// space count
@@ -714,12 +821,12 @@ void Board::doNullMove( UndoInfo &ui )
 	// update ep square
 	if ( bep )
 	{
-		bhash ^= Zobrist::epFile[ SquarePack::file( bep ) ];
+		hashEp( bep );
 		bep = 0;
 	}
 
 	// finally change stm
-	bhash ^= Zobrist::turn;
+	hashTurn();
 	bturn = flip( bturn );
 	assert( isValid() );
 }
@@ -767,10 +874,10 @@ void Board::doCastlingMove( Move move, UndoInfo &ui, bool ischeck )
 	bb[bbi] ^= rft;
 
 	// update zobrist hashes
-	bhash ^= Zobrist::piece[ color ][ ptKing ][ kfrom ];
-	bhash ^= Zobrist::piece[ color ][ ptKing ][ kto ];
-	bhash ^= Zobrist::piece[ color ][ ptRook ][ rfrom ];
-	bhash ^= Zobrist::piece[ color ][ ptRook ][ rto ];
+	hashPiece( color, ptKing, kfrom );
+	hashPiece( color, ptKing, kto );
+	hashPiece( color, ptRook, rfrom );
+	hashPiece( color, ptRook, rto );
 
 	// save pieces
 	ui.savePiece( kfrom, piece( kfrom ) );
@@ -800,20 +907,20 @@ void Board::doCastlingMove( Move move, UndoInfo &ui, bool ischeck )
 	bkingPos[ color ] = kto;
 
 	// lose castling rights
-	bhash ^= Zobrist::cast[ color ][ cr ];
+	hashCast( color, cr );
 	bcastRights[ color ] = 0;
 
 	// don't forget to update ep square
 	if ( bep )
 	{
-		bhash ^= Zobrist::epFile[ SquarePack::file( bep ) ];
+		hashEp( bep );
 		bep = 0;
 	}
 
 	bcheck = ischeck;
 
 	// finally flip turn
-	bhash ^= Zobrist::turn;
+	hashTurn();
 	bturn = flip( turn() );
 
 	if ( bcheck )
@@ -926,6 +1033,9 @@ void Board::undoMove( const UndoInfo &ui )
 {
 	// first restore hash, ep square and delta material
 	bhash = ui.bhash;
+#ifdef USE_SIG128
+	bhashHi = ui.bhashHi;
+#endif
 	bep = ui.ep;
 
 	// restore bitboards
@@ -1346,6 +1456,96 @@ static bool parseSANSquare( const char *&ptr, int &file, int &rank )
 	return 1;
 }
 
+// targeted SAN resolve (candidate origins from attack tables, no full movegen)
+Move Board::fromSANFast( Piece pt, Piece promo, int ff, int fr, Square to ) const
+{
+	// evasions are left to movegen (pseudoIsLegal doesn't filter non-slider checks)
+	if ( inCheck() )
+		return mcNone;
+
+	Color color = turn();
+	Piece tp = piece( to );
+	// own piece at target could still be a castling alternative
+	if ( tp != ptNone && (PiecePack::color( tp ) == color || PiecePack::type( tp ) == ptKing) )
+		return mcNone;
+	bool capture = tp != ptNone;
+
+	Bitboard occ = occupied();
+	Bitboard cand;
+	Move flags = capture ? mfCapture : mfNone;
+
+	switch( pt )
+	{
+	case ptPawn:
+		{
+			Rank rr = SquarePack::relRank( color, to );
+			if ( (rr == RANK8) != (promo != ptNone) )
+				return mcNone;
+			Bitboard pawns = pieces( color, ptPawn );
+			if ( capture || (bep && to == bep) )
+			{
+				cand = Tables::pawnAttm[ flip(color) ][ to ] & pawns;
+				if ( !capture )
+					flags = mfEpCapture;
+			}
+			else
+			{
+				if ( (ff >= 0 && ff != (int)SquarePack::file(to)) || rr == RANK1 || rr == RANK2 )
+					return mcNone;
+				Square back = color == ctWhite ? to + 8 : to - 8;
+				cand = pawns & BitOp::oneShl( back );
+				if ( !cand && rr == RANK4 && isVacated( back ) )
+					cand = pawns & BitOp::oneShl( color == ctWhite ? back + 8 : back - 8 );
+			}
+			flags |= (Move)promo << msPromo;
+		}
+		break;
+	case ptKnight:
+		cand = Tables::knightAttm[ to ] & pieces( color, ptKnight );
+		break;
+	case ptBishop:
+		cand = Magic::bishopAttm( to, occ ) & pieces( color, ptBishop );
+		break;
+	case ptRook:
+		cand = Magic::rookAttm( to, occ ) & pieces( color, ptRook );
+		break;
+	case ptQueen:
+		cand = Magic::queenAttm( to, occ ) & pieces( color, ptQueen );
+		break;
+	case ptKing:
+		cand = Tables::kingAttm[ to ] & BitOp::oneShl( king( color ) );
+		break;
+	default:
+		return mcNone;
+	}
+	if ( pt != ptPawn && promo != ptNone )
+		return mcNone;
+
+	Move res = mcNone;
+	Bitboard pin = 0;
+	bool pinsValid = 0;
+	while ( cand )
+	{
+		Square from = BitOp::popBit( cand );
+		if ( ff >= 0 && (int)SquarePack::file(from) != ff )
+			continue;
+		if ( fr >= 0 && (int)SquarePack::rank(from) != fr )
+			continue;
+		if ( !pinsValid )
+		{
+			pin = pins();
+			pinsValid = 1;
+		}
+		Move m = MovePack::init( from, to ) | flags;
+		if ( !pseudoIsLegal<0>( m, pin ) )
+			continue;
+		if ( res != mcNone )
+			return mcNone;		// ambiguous => let full generation reject it
+		res = m;
+	}
+	return res;
+}
+
 // move from SAN
 Move Board::fromSAN( const char *&ptr ) const
 {
@@ -1501,6 +1701,11 @@ Move Board::fromSAN( const char *&ptr ) const
 	if ( *ptr == '+' || *ptr == '#' )
 		ptr++;
 
+	// try fast path first
+	res = fromSANFast( pt, promo, ff, fr, SquarePack::init( (File)tf, (Rank)tr ) );
+	if ( res != mcNone )
+		return res;
+
 	// generate legal moves
 	MoveGen mg(*this);
 	Move moves[ maxMoves + 4 ];
@@ -1582,6 +1787,48 @@ Move Board::fromSAN( const std::string &str ) const
 	return fromSAN( ptr );
 }
 
+// skip anything that can't start a move (whitespace, move numbers, ellipsis, NAGs, brackets, evals, ...)
+static const char *skipMoveSeparators( const char *c )
+{
+	while ( *c && !((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z')) )
+		c++;
+	return c;
+}
+
+// decode move sequence
+uint Board::decodeMoves( const char *str, Move *moves, uint maxCount, Board *tip,
+	const char **stop, const char **ends ) const
+{
+	Board b( *this );
+	uint count = 0;
+	const char *last = str;
+	const char *c = str;
+	while ( count < maxCount )
+	{
+		c = skipMoveSeparators( c );
+		Move m = b.fromSAN( c );
+		if ( m == mcNone )
+			break;
+		// optional annotation
+		while ( *c == '!' || *c == '?' )
+			c++;
+		moves[ count ] = m;
+		if ( ends )
+			ends[ count ] = c;
+		count++;
+		last = c;
+		UndoInfo ui;
+		b.doMove( m, ui, b.isCheck( m, b.discovered() ) );
+		if ( b.turn() == ctWhite )
+			b.incMove();
+	}
+	if ( tip )
+		*tip = b;
+	if ( stop )
+		*stop = last;
+	return count;
+}
+
 bool Board::compare( const Board &tmp ) const
 {
 	if ( tmp.bhash != bhash )
@@ -1648,6 +1895,10 @@ bool Board::isValid() const
 
 	if ( tmp.bhash != bhash )
 		return 0;
+#ifdef USE_SIG128
+	if ( tmp.bhashHi != bhashHi )
+		return 0;
+#endif
 	if ( tmp.bpawnHash != bpawnHash )
 		return 0;
 	if ( memcmp( tmp.bb, bb, inCheck() ? sizeof(bb) : sizeof(Bitboard) * bbiEvMask ) != 0 )
@@ -2080,4 +2331,40 @@ void Board::autoCastlingRights()
 
 }
 
+// FENCache
+
+FENCache::FENCache()
+{
+	clear();
+}
+
+void FENCache::clear()
+{
+	hash = 0;
+	move = fifty = 0;
+	frc = 0;
+	fen[0] = 0;
+}
+
+// FEN of b (null terminated), valid until next call
+const char *FENCache::get( const Board &b )
+{
+	if ( !fen[0] || hash != b.sig() || move != b.move() || fifty != b.fifty() || frc != b.fischerRandom() )
+	{
+		char buf[256];
+		char *end = b.toFEN( buf );
+		size_t len = (size_t)(end - buf);
+		assert( len < sizeof(fen) );
+		if ( len >= sizeof(fen) )
+			len = sizeof(fen)-1;
+		memcpy( fen, buf, len );
+		fen[ len ] = 0;
+		hash = b.sig();
+		move = b.move();
+		fifty = b.fifty();
+		frc = b.fischerRandom();
+	}
+	return fen;
+}
+
 }
@@ -30,6 +30,7 @@ freely, subject to the following restrictions:
 #include "zobrist.h"
 #include <string>
 #include <stdlib.h>
+#include <memory.h>
 #include <iostream>
 
 // TODO: move large methods to cpp
@@ -51,11 +52,43 @@ enum UndoFlags
 
 class Board;
 
+// packed position (32 bytes) for storage and caches, see Board::pack/unpack
+// multi-byte fields are in host byte order
+struct PackedBoard
+{
+	enum Flags
+	{
+		pfFRC	= 1,					// fischer random
+		pfArena	= 2						// FRC Arena mode
+	};
+
+	Bitboard occ;						// occupied squares
+	u8 pieces[16];						// pieces (color << 3 | type) in occ LSBit order, low nibble first
+	u8 turnEp;							// bit 7: side to move, bits 0-6: ep square (0 = none)
+	FiftyCount fifty;					// fifty move counter
+	CastRights castRights[2];			// castling rights for white/black
+	u16 move;							// move number
+	u8 flags;							// Flags
+	u8 reserved;						// always 0
+
+	inline bool operator ==( const PackedBoard &o ) const
+	{
+		return memcmp( this, &o, sizeof(PackedBoard) ) == 0;
+	}
+	inline bool operator !=( const PackedBoard &o ) const
+	{
+		return !(*this == o);
+	}
+};
+
 struct UndoInfo
 {
 	UndoMask flags;				// undo flags
 	// ep square will be restored
 	Signature bhash;			// board hash (always)
+#ifdef USE_SIG128
+	Signature bhashHi;			// high half of 128-bit signature (always)
+#endif
 	Signature phash;			// pawn hash (optional)
 	Bitboard bb[7];				// bitboards to restore
 	DMat dmat[2];				// original delta-material (always)
@@ -100,6 +133,9 @@ protected:
 	friend class MoveGen;
 
 	Signature bhash;			// current hash signature
+#ifdef USE_SIG128
+	Signature bhashHi;			// high half of 128-bit signature
+#endif
 	Signature bpawnHash;		// current pawn hash signature
 	Bitboard bb[ bbiMax ];		// bitboard for pieces (indexed using BBI)
 	Piece bpieces[ 64 ];		// pieces: color in MSBit
@@ -119,10 +155,49 @@ protected:
 	// castling move is special
 	void doCastlingMove( Move move, UndoInfo &ui, bool ischeck );
 
+	// hash updates (also keep high half of 128-bit signature if tracked)
+	inline void hashPiece( Color c, Piece p, Square sq )
+	{
+		bhash ^= Zobrist::piece[ c ][ p ][ sq ];
+#ifdef USE_SIG128
+		bhashHi ^= Zobrist::pieceHi[ c ][ p ][ sq ];
+#endif
+	}
+
+	inline void hashCast( Color c, CastRights cr )
+	{
+		bhash ^= Zobrist::cast[ c ][ cr ];
+#ifdef USE_SIG128
+		bhashHi ^= Zobrist::castHi[ c ][ cr ];
+#endif
+	}
+
+	inline void hashEp( Square ep )
+	{
+		bhash ^= Zobrist::epFile[ SquarePack::file( ep ) ];
+#ifdef USE_SIG128
+		bhashHi ^= Zobrist::epFileHi[ SquarePack::file( ep ) ];
+#endif
+	}
+
+	inline void hashTurn()
+	{
+		bhash ^= Zobrist::turn;
+#ifdef USE_SIG128
+		bhashHi ^= Zobrist::turnHi;
+#endif
+	}
+
+	// compute hash from scratch using low or high key set
+	Signature computeHash( bool hi ) const;
+
 	inline void initUndo( UndoInfo &ui ) const
 	{
 		ui.clear();						// clear undo mask
 		ui.bhash = bhash;				// hash signature always preserved
+#ifdef USE_SIG128
+		ui.bhashHi = bhashHi;
+#endif
 		ui.ep = bep;					// ep square always preserved
 	}
 
@@ -166,6 +241,10 @@ protected:
 
 	template< Color c > Draw isDrawByMaterial( MaterialKey mk ) const;
 
+	// targeted SAN resolve (candidate origins from attack tables, no full movegen)
+	// returns mcNone if not resolved => caller must fall back to full generation
+	Move fromSANFast( Piece pt, Piece promo, int ff, int fr, Square to ) const;
+
 	void calcEvasMask();
 
 public:
@@ -206,6 +285,19 @@ public:
 		return bhash;
 	}
 
+	// 128-bit signature, stable for the same Zobrist::version (for persisted indices)
+	inline Signature128 sig128() const
+	{
+		Signature128 res;
+		res.lo = bhash;
+#ifdef USE_SIG128
+		res.hi = bhashHi;
+#else
+		res.hi = computeHash( 1 );
+#endif
+		return res;
+	}
+
 	// simply returns pawn hash signature
 	inline Signature pawnSig() const
 	{
@@ -273,7 +365,7 @@ public:
 		assert( PiecePack::type( toPiece ) );
 
 		// hash update
-		bhash ^= Zobrist::piece[ color ][ ptype ][ from ];
+		hashPiece( color, ptype, from );
 
 		if ( capture || ptype == ptPawn )
 			// irreversible move
@@ -296,7 +388,7 @@ public:
 				assert( promo <= ptQueen );
 				toPiece &= pmColor;
 				toPiece |= promo;
-				bhash ^= Zobrist::piece[ color ][ promo ][ to ];
+				hashPiece( color, promo, to );
 
 				bbi = BBI( color, ptPawn );
 				ui.saveBB( bbi, bb[ bbi ] );
@@ -320,9 +412,8 @@ public:
 				ui.saveBB( bbi, bb[ bbi ] );
 				bb[ bbi ] ^= ftmask;
 
-				Signature tosig = Zobrist::piece[ color ][ ptPawn ][ to ];
-				bhash ^= tosig;
-				bpawnHash ^= tosig;
+				hashPiece( color, ptPawn, to );
+				bpawnHash ^= Zobrist::piece[ color ][ ptPawn ][ to ];
 			}
 		} else
 		{
@@ -333,7 +424,7 @@ public:
 				bb[ bbi ] ^= ftmask;
 			}
 
-			bhash ^= Zobrist::piece[ color ][ ptype ][ to ];
+			hashPiece( color, ptype, to );
 		}
 
 		CastRights cr;
@@ -348,7 +439,7 @@ public:
 			if ( cr )
 			{
 				// losing all castling rights
-				bhash ^= Zobrist::cast[ color ][ cr ];
+				hashCast( color, cr );
 				bcastRights[ color ] = 0;
 			}
 		} else if ( ptype == ptRook && cr )
@@ -362,9 +453,9 @@ public:
 					|| (rf < kf && rf == CastPack::longFile(cr)) )
 				{
 					saveCastling<0>(ui);
-					bhash ^= Zobrist::cast[ color ][ cr ];
+					hashCast( color, cr );
 					bcastRights[ color ] = CastPack::loseFile( SquarePack::file( from ), cr );
-					bhash ^= Zobrist::cast[ color ][ castRights( color ) ];
+					hashCast( color, castRights( color ) );
 				}
 			}
 		}
@@ -394,23 +485,22 @@ public:
 					if ( CastPack::longFile( tcr ) == f )
 					{
 						saveCastling<1>(ui);
-						bhash ^= Zobrist::cast[ opc ][ tcr ];
+						hashCast( opc, tcr );
 						bcastRights[opc] = CastPack::loseLong( tcr );
-						bhash ^= Zobrist::cast[ opc ][ castRights( opc ) ];
+						hashCast( opc, castRights( opc ) );
 					}
 					else if ( CastPack::shortFile( tcr ) == f )
 					{
 						saveCastling<1>(ui);
-						bhash ^= Zobrist::cast[ opc ][ tcr ];
+						hashCast( opc, tcr );
 						bcastRights[opc] = CastPack::loseShort( tcr );
-						bhash ^= Zobrist::cast[ opc ][ castRights( opc ) ];
+						hashCast( opc, castRights( opc ) );
 					}
 				}
 			}
-			Signature tosig = Zobrist::piece[ flip(color) ][ captype ][ cto ];
-			bhash ^= tosig;
+			hashPiece( flip(color), captype, cto );
 			if ( captype == ptPawn )
-				bpawnHash ^= tosig;
+				bpawnHash ^= Zobrist::piece[ flip(color) ][ ptPawn ][ cto ];
 
 			Bitboard capmask = (ptype == ptPawn ? BitOp::oneShl( cto ) : tomask);
 
@@ -455,7 +545,7 @@ public:
 		// update ep square
 		if ( bep )
 		{
-			bhash ^= Zobrist::epFile[ SquarePack::file( bep ) ];
+			hashEp( bep );
 			bep = 0;
 		}
 		if ( ptype == ptPawn )
@@ -470,13 +560,13 @@ public:
 				// note: this slows my pawn-push movegen a tiny bit BUT it avoid dup hashes in useless cases,
 				// especially useful for books
 				if ( Tables::pawnAttm[color][bep] & pieces( flip(color), ptPawn ) )
-					bhash ^= Zobrist::epFile[ SquarePack::file( bep ) ];
+					hashEp( bep );
 				else bep = 0;
 			}
 		}
 
 		// finally change stm
-		bhash ^= Zobrist::turn;
+		hashTurn();
 		bturn = flip( bturn );
 
 		if ( isCheck )
@@ -486,6 +576,7 @@ public:
 		assert( bcheck == doesAttack<1>( flip(bturn), king( bturn ) ) );
 		assert( bhash == recomputeHash() );
 		assert( bpawnHash == recomputePawnHash() );
+		assert( sig128().hi == computeHash( 1 ) );
 		assert( isValid() );
 	}
 
@@ -852,6 +943,12 @@ public:
 	// fast version, doesn't add null terminator
 	char *toFEN(char *dst) const;
 
+	// pack position (fails only if more than 32 pieces on board)
+	bool pack( PackedBoard &pb ) const;
+	// unpack position
+	// returns 0 on error (kings missing or invalid pieces)
+	bool unpack( const PackedBoard &pb );
+
 	// move to SAN
 	std::string toSAN( Move m ) const;
 	// fast version, doesn't add null terminator
@@ -866,6 +963,15 @@ public:
 	// move from SAN (includes legality check)
 	Move fromSAN( const char *&ptr ) const;
 	Move fromSAN( const std::string &str ) const;
+	// decode move sequence (SAN or UCI, skips anything that can't start a move, like move numbers,
+	// "...", NAGs, brackets or evals, and !? annotations)
+	// stops at first token that isn't a legal move or when maxCount is reached
+	// tip (optional): board after decoded moves (move counter advanced)
+	// stop (optional): end of last decoded move (str if none)
+	// ends (optional, maxCount entries): end of each decoded move token
+	// returns number of decoded moves, doesn't allocate
+	uint decodeMoves( const char *str, Move *moves, uint maxCount, Board *tip = 0,
+		const char **stop = 0, const char **ends = 0 ) const;
 
 	// recompute hash (debug)
 	Signature recomputeHash() const;
@@ -890,4 +996,24 @@ public:
 	bool compare( const Board &tmp ) const;
 };
 
+// FEN of the last board asked for, keyed by signature, move counters and FRC flag
+// kept outside Board so that board copies stay small and immutable; not thread-safe,
+// each owner keeps its own (edited boards must be hashed via updateBitboards first)
+class FENCache
+{
+public:
+	FENCache();
+
+	// FEN of b (null terminated), valid until next call
+	const char *get( const Board &b );
+	void clear();
+
+private:
+	Signature hash;
+	uint move;
+	uint fifty;
+	bool frc;
+	char fen[ 96 ];
+};
+
 }
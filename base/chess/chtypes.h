@@ -50,6 +50,12 @@ using core::b8;
 
 #define U64C(x) ((u64)(x##ll))
 
+// maintain 128-bit signature incrementally (define CHENG_SIG128 to enable, otherwise the high half
+// is computed on demand; keeps Board and UndoInfo small for builds that don't need it)
+#if defined(CHENG_SIG128)
+#	define USE_SIG128
+#endif
+
 // enums are only used as constants
 
 // trivial draw types
@@ -190,6 +196,21 @@ typedef u8 Distance;
 typedef u64 Bitboard;
 // hash signature
 typedef u64 Signature;
+
+// 128-bit hash signature (lo is the regular signature)
+struct Signature128
+{
+	Signature lo, hi;
+
+	inline bool operator ==( const Signature128 &o ) const
+	{
+		return lo == o.lo && hi == o.hi;
+	}
+	inline bool operator !=( const Signature128 &o ) const
+	{
+		return !(*this == o);
+	}
+};
 // material key
 typedef u64 MaterialKey;
 // material piece count
@@ -31,6 +31,9 @@ freely, subject to the following restrictions:
 namespace cheng4
 {
 
+// magic attack tables are generated into gentables.cpp when LIVIUS_GENTABLES is set
+#if !defined(LIVIUS_GENTABLES)
+
 #define STOP_RAY(i)	\
 			(i) = ((i)+7) / 7 * 7;	\
 			(i)--;
@@ -279,12 +282,14 @@ static void initNewMovTab()
 	}
 }
 
-Bitboard Magic::rookRelOcc[64];
-Bitboard Magic::bishopRelOcc[64];
-u8 Magic::rookShr[64];
-u8 Magic::bishopShr[64];
-const Bitboard *Magic::rookPtr[64];
-const Bitboard *Magic::bishopPtr[64];
+CHENG_ALIGN64 Magic::Entry Magic::rookEntry[64];
+CHENG_ALIGN64 Magic::Entry Magic::bishopEntry[64];
+CHENG_ALIGN64 Bitboard Magic::magicAttacks[ Magic::attackTableSize ];
+#ifdef USE_PEXT
+CHENG_ALIGN64 Bitboard Magic::pextAttacks[ Magic::attackTableSize ];
+#endif
+
+#endif
 
 const Bitboard Magic::rookMagic[64] = {
 	U64C(0x80001820804000),
@@ -420,6 +425,8 @@ const Bitboard Magic::bishopMagic[64] = {
 	U64C(0x284100220540484)
 };
 
+#if !defined(LIVIUS_GENTABLES)
+
 static Bitboard indexToU64( int index, int bits, u64 m )
 {
 	Bitboard result = 0;
@@ -480,43 +487,33 @@ static u64 batt(int sq, u64 block)
 	return result;
 }
 
-u32 Magic::initMagicPtrs( Square sq, bool bishop )
+// returns table size
+u32 Magic::initAttacks( Square sq, bool bishop, u32 offset )
 {
-	i32 i, n;
-	const u64 &mask = bishop ? bishopRelOcc[sq] : rookRelOcc[sq];
-	n = BitOp::popCount(mask);
-
-	// max 12 bits!
-	Bitboard *b = new Bitboard[ 4096 ];
-	Bitboard *a = new Bitboard[ (size_t)1u << n ];
+	Entry &e = bishop ? bishopEntry[sq] : rookEntry[sq];
+	i32 n = (i32)BitOp::popCount(e.mask);
+	e.offset = offset;
 
+	Bitboard *a = magicAttacks + offset;
 	memset( a, 0, ((size_t)1u << n) * sizeof(Bitboard) );
 
-	for (i = 0; i < (i32)(1 << n); i++) {
-		b[i] = indexToU64(i, n, mask);
-
-		i32 j;
-		if ( bishop )
-			j = (i32)((b[i] * bishopMagic[sq]) >> bishopShr[sq]);
-		else
-			j = (i32)((b[i] * rookMagic[sq]) >> rookShr[sq]);
-
-		a[j] = bishop ? batt(sq, b[i]) : ratt(sq, b[i]);
-	}
-	if ( bishop )
-	{
-		bishopPtr[ sq ] = a;
-	}
-	else
-	{
-		rookPtr[ sq ] = a;
+	for (i32 i = 0; i < (i32)(1 << n); i++) {
+		Bitboard occ = indexToU64(i, n, e.mask);
+		u32 j = (u32)((occ * e.magic) >> e.shift);
+		a[j] = bishop ? batt(sq, occ) : ratt(sq, occ);
+#ifdef USE_PEXT
+		// pext of occ is i (indexToU64 deposits index bits into mask)
+		pextAttacks[ offset + i ] = a[j];
+#endif
 	}
-	delete[] b;
-	return 8 * (1<<n);
+	return 1u << n;
 }
 
+#endif
+
 void Magic::init()
 {
+#if !defined(LIVIUS_GENTABLES)
 	initNewMovTab();
 
 	for (uint i=0; i<64; i++)
@@ -534,8 +531,10 @@ void Magic::init()
 			}
 			cur = rmnew[ i ][ cur ].next;
 		}
-		rookRelOcc[ i ] = msk;
-		rookShr[ i ] = (u8)(64-BitOp::popCount(msk));
+		memset( rookEntry + i, 0, sizeof(Entry) );
+		rookEntry[ i ].mask = msk;
+		rookEntry[ i ].magic = rookMagic[ i ];
+		rookEntry[ i ].shift = 64-BitOp::popCount(msk);
 
 		// bishop
 		msk = 0;
@@ -549,24 +548,54 @@ void Magic::init()
 			}
 			cur = bmnew[ i ][ cur ].next;
 		}
-		bishopRelOcc[ i ] = msk;
-		bishopShr[ i ] = (u8)(64-BitOp::popCount(msk));
+		memset( bishopEntry + i, 0, sizeof(Entry) );
+		bishopEntry[ i ].mask = msk;
+		bishopEntry[ i ].magic = bishopMagic[ i ];
+		bishopEntry[ i ].shift = 64-BitOp::popCount(msk);
 	}
 
-	for (Square i=0; i<64; i++)
-		for (uint j=0; j<2; j++)
-			initMagicPtrs( i, j ? 1 : 0 );
+	u32 offset = 0;
+	for (uint j=0; j<2; j++)
+		for (Square i=0; i<64; i++)
+			offset += initAttacks( i, j ? 1 : 0, offset );
+	assert( offset == attackTableSize );
+#endif
 }
 
+// nothing to free, kept for symmetry with init
 void Magic::done()
 {
-	for (Square i=0; i<64; i++)
+}
+
+#ifdef USE_PEXT
+bool Magic::verifyPext()
+{
+	for (Square sq=0; sq<64; sq++)
 	{
-		if ( bishopPtr[i] )
-			delete[] bishopPtr[i];
-		if ( rookPtr[i] )
-			delete[] rookPtr[i];
+		for (uint j=0; j<2; j++)
+		{
+			const Entry &e = j ? bishopEntry[sq] : rookEntry[sq];
+			const uint n = BitOp::popCount(e.mask);
+			for (uint i=0; i < (1u << n); i++)
+			{
+				// deposit index bits into mask
+				Bitboard occ = 0, m = e.mask;
+				for (uint k=0; k<n; k++)
+				{
+					Square s = BitOp::popBit( m );
+					if ( i & (1u << k) )
+						occ |= BitOp::oneShl( s );
+				}
+				Bitboard magic = magicAttacks[ e.offset + ((occ * e.magic) >> e.shift) ];
+				if ( magic != pextAttacks[ e.offset + i ] )
+					return 0;
+				if ( BitOp::hasHwPext() && BitOp::pext( occ, e.mask ) != i )
+					return 0;
+			}
+		}
 	}
+	return 1;
 }
+#endif
 
 }
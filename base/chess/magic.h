@@ -34,34 +34,66 @@ namespace cheng4
 // singleton
 class Magic
 {
+public:
+	// attack table sizes (sum of 1 << relevant bits over all squares)
+	enum
+	{
+		rookTableSize = 102400,
+		bishopTableSize = 5248,
+		attackTableSize = rookTableSize + bishopTableSize
+	};
+
+	// per-square lookup data; 32 bytes so that two squares share a cache line
+	struct Entry
+	{
+		Bitboard mask;			// relevant occupancy mask
+		Bitboard magic;			// magic multiplier
+		u32 offset;				// offset into attack tables
+		u32 shift;				// magic shr
+		u64 pad;
+	};
 protected:
-	static u32 initMagicPtrs( Square sq, bool bishop );
-	// rook/bishop relevant occupancy masks
-	static Bitboard rookRelOcc[64];
-	static Bitboard bishopRelOcc[64];
-	// rook/bishop magic shr
-	static u8 rookShr[64];
-	static u8 bishopShr[64];
-	// rook/bishop magic pointers
-	static const Bitboard *rookPtr[64];
-	static const Bitboard *bishopPtr[64];
+	static u32 initAttacks( Square sq, bool bishop, u32 offset );
+	// rook/bishop lookup data
+	static CHENG_ALIGN64 CHENG_TABLE Entry rookEntry[64];
+	static CHENG_ALIGN64 CHENG_TABLE Entry bishopEntry[64];
+	// rook/bishop attacks in one contiguous table (rooks first), indexed by magic hash
+	static CHENG_ALIGN64 CHENG_TABLE Bitboard magicAttacks[ attackTableSize ];
+#ifdef USE_PEXT
+	// same layout, indexed by pext of relevant occupancy
+	static CHENG_ALIGN64 CHENG_TABLE Bitboard pextAttacks[ attackTableSize ];
+#endif
 	// rook/bishop magic multipliers
 	static const Bitboard rookMagic[64];
 	static const Bitboard bishopMagic[64];
+
+	static inline Bitboard attm( const Entry &e, Bitboard occ )
+	{
+#ifdef USE_PEXT
+		if ( BitOp::hasHwPext() )
+			return pextAttacks[ e.offset + BitOp::pext( occ, e.mask ) ];
+#endif
+		return magicAttacks[ e.offset + (((occ & e.mask) * e.magic) >> e.shift) ];
+	}
 public:
 	static void init();
 	static void done();
 
+#ifdef USE_PEXT
+	// compare pext tables against magic tables for all relevant occupancies
+	static bool verifyPext();
+#endif
+
 	// occ: block mask
 	static inline Bitboard rookAttm( Square sq, Bitboard occ )
 	{
-		return rookPtr[ sq ][ (rookMagic[ sq ] * (occ & rookRelOcc[ sq ])) >> rookShr[ sq ] ];
+		return attm( rookEntry[ sq ], occ );
 	}
 
 	// occ: block mask
 	static inline Bitboard bishopAttm( Square sq, Bitboard occ )
 	{
-		return bishopPtr[ sq ][ (bishopMagic[ sq ] * (occ & bishopRelOcc[ sq ])) >> bishopShr[ sq ] ];
+		return attm( bishopEntry[ sq ], occ );
 	}
 
 	// occ: block mask
@@ -135,6 +135,45 @@ loop:
 	return res & mmNoScore;				// remove score
 }
 
+// bulk generate all legal moves into buffer (must hold maxMoves entries)
+MoveCount MoveGen::generateLegal( const Board &b, Move *moves )
+{
+	Move buf[ maxMoves ];
+	Bitboard pin = b.pins();
+	MoveCount res = 0;
+	MoveCount count;
+
+	if ( b.inCheck() )
+	{
+		count = generateEvasions( b, buf );
+		for ( MoveCount i=0; i<count; i++ )
+			if ( b.pseudoIsLegal<1>( buf[i], pin ) )
+				moves[ res++ ] = buf[i] & mmNoScore;
+		return res;
+	}
+
+	count = generateCaptures( b, buf );
+	for ( MoveCount i=0; i<count; i++ )
+		if ( b.pseudoIsLegal<0>( buf[i], pin ) )
+			moves[ res++ ] = buf[i] & mmNoScore;
+
+	if ( b.canCastle() )
+	{
+		// castling moves are generated legal
+		count = b.turn() == ctWhite ? generateCastling< ctWhite >( b, buf )
+			: generateCastling< ctBlack >( b, buf );
+		for ( MoveCount i=0; i<count; i++ )
+			moves[ res++ ] = buf[i] & mmNoScore;
+	}
+
+	count = generateQuiet( b, buf );
+	for ( MoveCount i=0; i<count; i++ )
+		if ( b.pseudoIsLegal<0>( buf[i], pin ) )
+			moves[ res++ ] = buf[i] & mmNoScore;
+	assert( res <= maxMoves );
+	return res;
+}
+
 // can't assign
 MoveGen &MoveGen::operator =( const MoveGen & )
 {
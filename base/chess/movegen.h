@@ -624,6 +624,10 @@ public:
 	// generate next move, if mcNone is returned => no more moves available
 	Move next();
 
+	// bulk generate all legal moves into buffer (must hold maxMoves entries)
+	// same moves in same order as next(), returns move count
+	static MoveCount generateLegal( const Board &b, Move *moves );
+
 	// returns discovered checkers mask (always)
 	inline Bitboard discovered() const
 	{
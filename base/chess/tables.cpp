@@ -34,6 +34,8 @@ namespace cheng4
 
 // Tables
 
+// runtime-initialized tables (defined in gentables.cpp instead when LIVIUS_GENTABLES is set)
+#if !defined(LIVIUS_GENTABLES)
 u8 Tables::lsBit16[ 65536 ];
 u8 Tables::msBit16[ 65536 ];
 u8 Tables::popCount16[ 65536 ];
@@ -58,6 +60,8 @@ Bitboard Tables::chainMask[ 64 ];
 Bitboard Tables::outpostMask[ 2 ][ 64 ];
 u8 Tables::moveValid[ 64 ][ 64 ];
 u8 Tables::distance[ 64 ][ 64 ];
+Bitboard Tables::fileMask[8];
+#endif
 const Bitboard Tables::seventhRank[2] = {
 	U64C(0x000000000000ff00),
 	U64C(0x00ff000000000000)
@@ -66,7 +70,6 @@ const Bitboard Tables::eighthRank[2] = {
 	U64C(0x00000000000000ff),
 	U64C(0xff00000000000000)
 };
-Bitboard Tables::fileMask[8];
 const u8 Tables::seeValue[] = { 0, 1, 3, 3, 5, 9, 99 };
 const u8 Tables::npValue[] = { 0, 0, 3, 3, 5, 9, 0 };
 const int Tables::sign[ctMax] = {1, -1};
@@ -78,6 +81,7 @@ const Score Tables::gainCap[ ptMax ] = { 100, 100, 325, 325, 500, 975, 0};	// ca
 
 void Tables::init()
 {
+#if !defined(LIVIUS_GENTABLES)
 	// bitcount/lsbit/msbit tables
 	for (u32 i=0; i<65536; i++)
 	{
@@ -395,11 +399,13 @@ void Tables::init()
 		b |= b >> 8;
 		chainMask[i] = b;
 	}
+#endif
 }
 
 // BitOp
 
 bool BitOp::hwPopCnt = 0;
+bool BitOp::hwPext = 0;
 
 // disable hardware popcount
 void BitOp::disableHwPopCount()
@@ -407,43 +413,60 @@ void BitOp::disableHwPopCount()
 	hwPopCnt = 0;
 }
 
-// static init (detects hw popcount)
-void BitOp::init()
+// disable hardware pext
+void BitOp::disableHwPext()
+{
+	hwPext = 0;
+}
+
+#if defined(_MSC_VER) || (defined(__GNUC__) && !defined(__ARM_ARCH))
+static void cpuId( int id[4], int leaf )
 {
 #ifdef _MSC_VER
-	int id[4] = {0};
-	__cpuid(id, 0);
-	int nids = id[0];
-	if ( nids >= 2 )
-	{
-		id[2] = 0;
-		__cpuid(id, 1);
-		hwPopCnt = (id[2] & 0x800000) != 0;
-	}
-#elif defined(__GNUC__) && !defined(__ARM_ARCH)
-	int id[4] = {0};
+	__cpuidex( id, leaf, 0 );
+#else
 	asm(
 		"cpuid":
 		"=a" (id[0]),
 		"=b" (id[1]),
 		"=c" (id[2]),
 		"=d" (id[3]) :
-		"a" (0)
+		"a" (leaf), "c" (0)
 	);
+#endif
+}
+#endif
+
+// static init (detects hw popcount and pext)
+void BitOp::init()
+{
+#if defined(_MSC_VER) || (defined(__GNUC__) && !defined(__ARM_ARCH))
+	int id[4] = {0};
+	cpuId( id, 0 );
 	int nids = id[0];
+	// vendor string in ebx, edx, ecx
+	bool amd = id[1] == 0x68747541 && id[3] == 0x69746e65 && id[2] == 0x444d4163;
+	uint family = 0;
 	if ( nids >= 2 )
 	{
 		id[2] = 0;
-		asm(
-			"cpuid":
-			"=a" (id[0]),
-			"=b" (id[1]),
-			"=c" (id[2]),
-			"=d" (id[3]) :
-			"a" (1)
-		);
+		cpuId( id, 1 );
 		hwPopCnt = (id[2] & 0x800000) != 0;
+		family = ((uint)id[0] >> 8) & 15;
+		if ( family == 15 )
+			family += ((uint)id[0] >> 20) & 255;
 	}
+	if ( nids >= 7 )
+	{
+		cpuId( id, 7 );
+		hwPext = (id[1] & 0x100) != 0;
+	}
+	// microcoded (very slow) pext on AMD before Zen 3
+	if ( amd && family < 0x19 )
+		hwPext = 0;
+#endif
+#ifndef USE_PEXT
+	hwPext = 0;
 #endif
 }
 
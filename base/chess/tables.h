@@ -35,6 +35,21 @@ freely, subject to the following restrictions:
 #include <intrin.h>
 #endif
 
+// LIVIUS_GENTABLES: precomputed tables are linked in from gentables.cpp (see gentables tool)
+// and live in read-only data; init() then has nothing to do
+#if defined(LIVIUS_GENTABLES)
+#	define CHENG_TABLE const
+#else
+#	define CHENG_TABLE
+#endif
+
+// cache line aligned static data
+#if defined(_MSC_VER)
+#	define CHENG_ALIGN64 __declspec(align(64))
+#else
+#	define CHENG_ALIGN64 __attribute__((aligned(64)))
+#endif
+
 namespace cheng4
 {
 
@@ -85,30 +100,30 @@ struct BitOp;
 // singleton
 struct Tables
 {
-	static Bitboard oneShlTab[64];
-	static Bitboard noneShlTab[256];        // FIXME: 256 instead of 64 due to silly gcc compiler warning?
-	static Bitboard kingAttm[64];
-	static Bitboard knightAttm[64];
-	static Bitboard pawnAttm[2][64];
-	static bool neighbor[64][64];
-	static Bitboard between[64][64];
-	static Bitboard ray[64][64];			// "infinite" ray [from][to], goes beyond to
-	static Bitboard diagAttm[64];			// diagonal pseudo attack mask
-	static Bitboard orthoAttm[64];			// orthogonal pseudo attack mask
-	static Bitboard queenAttm[64];			// queen pseudo attack mask
-	static Bitboard passerMask[2][64];		// passer mask [color][square]
-	static Bitboard frontMask[2][64];		// in front mask [color][square]
-	static Bitboard isoMask[8];				// isolated mask [file]
-	static Bitboard chainMask[64];			// chained mask [file]
-	static Bitboard outpostMask[2][64];		// outpost mask [color][square]: if there are no opp pawns in this mask
+	static CHENG_TABLE Bitboard oneShlTab[64];
+	static CHENG_TABLE Bitboard noneShlTab[256];        // FIXME: 256 instead of 64 due to silly gcc compiler warning?
+	static CHENG_TABLE Bitboard kingAttm[64];
+	static CHENG_TABLE Bitboard knightAttm[64];
+	static CHENG_TABLE Bitboard pawnAttm[2][64];
+	static CHENG_TABLE bool neighbor[64][64];
+	static CHENG_TABLE Bitboard between[64][64];
+	static CHENG_TABLE Bitboard ray[64][64];			// "infinite" ray [from][to], goes beyond to
+	static CHENG_TABLE Bitboard diagAttm[64];			// diagonal pseudo attack mask
+	static CHENG_TABLE Bitboard orthoAttm[64];			// orthogonal pseudo attack mask
+	static CHENG_TABLE Bitboard queenAttm[64];			// queen pseudo attack mask
+	static CHENG_TABLE Bitboard passerMask[2][64];		// passer mask [color][square]
+	static CHENG_TABLE Bitboard frontMask[2][64];		// in front mask [color][square]
+	static CHENG_TABLE Bitboard isoMask[8];				// isolated mask [file]
+	static CHENG_TABLE Bitboard chainMask[64];			// chained mask [file]
+	static CHENG_TABLE Bitboard outpostMask[2][64];		// outpost mask [color][square]: if there are no opp pawns in this mask
 											// then it may be an outpost
-	static u8 direction[64][64];			// [from][to]
-	static u8 moveValid[64][64];			// move valid: [from][to] & (1<<piece_type) (doesn't work for pawns)
-	static u8 distance[64][64];				// distance between squares (0-8)
+	static CHENG_TABLE u8 direction[64][64];			// [from][to]
+	static CHENG_TABLE u8 moveValid[64][64];			// move valid: [from][to] & (1<<piece_type) (doesn't work for pawns)
+	static CHENG_TABLE u8 distance[64][64];				// distance between squares (0-8)
 	static const Bitboard seventhRank[2];	// seventh rank mask
 	static const Bitboard eighthRank[2];	// eighth rank mask
-	static Bitboard fileMask[8];			// file mask
-	static i8 advance[ dirMax ];
+	static CHENG_TABLE Bitboard fileMask[8];			// file mask
+	static CHENG_TABLE i8 advance[ dirMax ];
 	static const u8 seeValue[ ptMax ];		// pawn = 1 ... queen = 9
 	static const u8 mvvValue[ ptMax ];		// none = 1 (enpassant), pawn = 1 ... queen = 5
 	static const u8 lvaValue[ ptMax ];		// pawn = 1 ..
@@ -138,17 +153,22 @@ struct Tables
 protected:
 	friend struct BitOp;
 	// pop counts for each 16-bit parts
-	static u8 popCount16[ 65536 ];
-	static u8 popCount8[ 256 ];
+	static CHENG_TABLE u8 popCount16[ 65536 ];
+	static CHENG_TABLE u8 popCount8[ 256 ];
 	// lsb/msb stuff
-	static u8 lsBit16[ 65536 ];
-	static u8 msBit16[ 65536 ];
+	static CHENG_TABLE u8 lsBit16[ 65536 ];
+	static CHENG_TABLE u8 msBit16[ 65536 ];
 };
 
 #if (defined(__GNUC__) && (defined(__LP64__) || defined(__x86_64__))) || (defined(_MSC_VER) && (defined(_M_AMD64) || defined(_M_X64)))
 #define IS_X64 1
 #endif
 
+// BMI2 pext slider attacks (selected at runtime, see BitOp::hasHwPext)
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#	define USE_PEXT
+#endif
+
 // singleton
 struct BitOp
 {
@@ -355,6 +375,24 @@ done:
 		return popCount< pcmNormal >( val );
 	}
 
+#ifdef USE_PEXT
+	// parallel bit extract (BMI2); only valid if hasHwPext()
+	static inline u64 pext( u64 val, u64 mask )
+	{
+	#ifdef _MSC_VER
+		return _pext_u64( val, mask );
+	#else
+		u64 res;
+		asm(
+			"pextq %2, %1, %0" :
+			"=r" (res) :
+			"r" (val), "rm" (mask)
+		);
+		return res;
+	#endif
+	}
+#endif
+
 	// shift bitboard one rank forward
 	template< Color c > static inline Bitboard shiftForward( Bitboard b )
 	{
@@ -393,12 +431,22 @@ done:
 	// disable hardware popcount
 	static void disableHwPopCount();
 
-	// static init (detects hw popcount)
+	// has fast hardware pext (BMI2)?
+	static inline bool hasHwPext()
+	{
+		return hwPext;
+	}
+
+	// disable hardware pext (falls back to magic multiply)
+	static void disableHwPext();
+
+	// static init (detects hw popcount and pext)
 	static void init();
 
 
 private:
 	static bool hwPopCnt;
+	static bool hwPext;
 };
 
 }
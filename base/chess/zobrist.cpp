@@ -32,33 +32,65 @@ namespace cheng4
 
 // Zobrist
 
+// keys are generated into gentables.cpp when LIVIUS_GENTABLES is set
+#if !defined(LIVIUS_GENTABLES)
 Signature	Zobrist::turn;					// turn (stm) xor-hash
 Signature	Zobrist::epFile[8];				// en-passant file hash [epfile]
 Signature	Zobrist::piece[2][ptMax][64];	// [color][piece][square]
 Signature	Zobrist::cast[2][0x88+1];		// castling rights [color][rights]
 
-void Zobrist::init()
+Signature	Zobrist::turnHi;
+Signature	Zobrist::epFileHi[8];
+Signature	Zobrist::pieceHi[2][ptMax][64];
+Signature	Zobrist::castHi[2][0x88+1];
+
+// fixed seed of version 1 keys (low keys first, then high keys, each in key layout order)
+static const u64 keySeed = U64C( 0x6c69766975730001 );
+
+static void fillKeys( const u64 *keys, Signature &turn, Signature *epFile, Signature (*piece)[ptMax][64],
+	Signature (*cast)[0x88+1] )
 {
-	core::PRNG prng;
-	// turn
-	turn = prng.next64();
+	turn = keys[ Zobrist::keyTurn ];
 
-	// epFile
 	for (int i=0; i<8; i++)
-		epFile[i] = prng.next64();
+		epFile[i] = keys[ Zobrist::keyEp + i ];
 
-	// piece
-	memset( piece, 0, sizeof(piece) );
+	memset( piece, 0, sizeof(Signature) * 2 * ptMax * 64 );
 	for (Color c=ctWhite; c<=ctBlack; c++)
 		for (Piece p=ptPawn; p<=ptKing; p++)
 			for (Square sq = 0; sq < 64; sq++ )
-				piece[c][p][sq] = prng.next64();
+				piece[c][p][sq] = keys[ Zobrist::pieceKeyIndex( c, p, sq ) ];
 
-	// castling
-	cast[ ctWhite ][0] = cast[ ctBlack ][0] = 0;
+	// castling: rights combine short/long keys (white short, white long, black short, black long);
+	// FRC rook files map to the same keys
 	for (Color c=ctWhite; c<=ctBlack; c++)
-		for (uint i=1; i<=0x88; i++)
-			cast[c][i] = prng.next64();
+		for (uint i=0; i<=0x88; i++)
+		{
+			CastRights cr = (CastRights)i;
+			Signature sig = 0;
+			if ( CastPack::allowedShort( cr ) )
+				sig ^= keys[ Zobrist::keyCastle + 2*c ];
+			if ( CastPack::allowedLong( cr ) )
+				sig ^= keys[ Zobrist::keyCastle + 2*c + 1 ];
+			cast[c][i] = sig;
+		}
+}
+#endif
+
+void Zobrist::init()
+{
+#if !defined(LIVIUS_GENTABLES)
+	core::PRNG prng( keySeed );
+	u64 keys[ keyCount ];
+
+	for (uint i=0; i<keyCount; i++)
+		keys[i] = prng.next64();
+	fillKeys( keys, turn, epFile, piece, cast );
+
+	for (uint i=0; i<keyCount; i++)
+		keys[i] = prng.next64();
+	fillKeys( keys, turnHi, epFileHi, pieceHi, castHi );
+#endif
 }
 
 }
@@ -25,20 +25,49 @@ freely, subject to the following restrictions:
 
 #pragma once
 
-#include "chtypes.h"
+#include "tables.h"
 
 namespace cheng4
 {
 
 // singleton
+// keys are generated from a fixed seed, so signatures are stable across builds and machines;
+// persisted signatures should be tagged with version
+// note: keys are livius-specific, signatures are not Polyglot book keys
 struct Zobrist
 {
+	enum
+	{
+		// bump whenever key generation or layout changes
+		version = 1,
+		// key layout: 768 piece keys, 4 castling keys, 8 ep file keys, turn
+		keyPiece = 0,
+		keyCastle = 768,
+		keyEp = 772,
+		keyTurn = 780,
+		keyCount = 781
+	};
+
 	static void init();
 
-	static Signature	turn;					// turn (stm) xor-hash
-	static Signature	epFile[8];				// en-passant file hash [epfile]
-	static Signature	piece[2][ptMax][64];	// [color][piece][square]
-	static Signature	cast[2][0x88+1];		// castling rights [color][rights]
+	// piece key index
+	static inline uint pieceKeyIndex( Color c, Piece p, Square sq )
+	{
+		assert( p >= ptPawn && p <= ptKing );
+		// black pawn = 0, white pawn = 1, ...; square a1 = 0
+		return keyPiece + 64 * (2*(p - ptPawn) + (c == ctWhite)) + (sq ^ 56);
+	}
+
+	static CHENG_TABLE Signature	turn;					// turn (stm) xor-hash
+	static CHENG_TABLE Signature	epFile[8];				// en-passant file hash [epfile]
+	static CHENG_TABLE Signature	piece[2][ptMax][64];	// [color][piece][square]
+	static CHENG_TABLE Signature	cast[2][0x88+1];		// castling rights [color][rights]
+
+	// independent keys for the high half of 128-bit signatures
+	static CHENG_TABLE Signature	turnHi;
+	static CHENG_TABLE Signature	epFileHi[8];
+	static CHENG_TABLE Signature	pieceHi[2][ptMax][64];
+	static CHENG_TABLE Signature	castHi[2][0x88+1];
 };
 
 }
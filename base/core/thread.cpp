@@ -350,4 +350,17 @@ void Thread::sleep( int ms )
 #endif
 }
 
+// returns number of logical CPUs (at least 1)
+uint Thread::cpuCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo( &si );
+	return si.dwNumberOfProcessors > 0 ? (uint)si.dwNumberOfProcessors : 1u;
+#else
+	long res = sysconf( _SC_NPROCESSORS_ONLN );
+	return res > 0 ? (uint)res : 1u;
+#endif
+}
+
 }
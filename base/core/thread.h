@@ -112,6 +112,9 @@ public:
 	// sleep in ms
 	static void sleep( int ms );
 
+	// returns number of logical CPUs (at least 1)
+	static uint cpuCount();
+
 	// returns current thread id
 	static void *current();
 };
@@ -24,10 +24,28 @@ freely, subject to the following restrictions:
 */
 
 #include "pgn.h"
+#include "pgnindexcache.h"
 #include <QFile>
+#include <algorithm>
+#include <string>
+#include <string.h>
+#ifndef _WIN32
+#	include <sys/mman.h>
+#endif
+
+// SSE2 lexer skipping (always available on x64)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define PGN_USE_SSE2
+#	include <emmintrin.h>
+#endif
 
 using namespace std;
 
+// indexing chunk size for memory-mapped files (progress/abort granularity)
+static const size_t mapChunkSize = 1 << 20;
+// minimum file size per indexing thread
+static const cheng4::u64 minParallelChunkSize = 4 << 20;
+
 // PGNMove
 
 PGNMove::PGNMove() : next(0)
@@ -68,12 +86,32 @@ void PGNLoadThread::abort()
 
 void PGNLoadThread::work()
 {
-	QFile lfile( file->fileName );
-	char buf[16384];
 	file->onLoadStarted();
 	file->clear();
-	qint64 pos = 0;
+	PGNFingerprint fp;
+	bool cacheable = file->useCache && PGNIndexCache::fingerprint( file->fileName, file->mapData, file->mapSize, fp );
+	if ( cacheable && loadCache( fp ) )
+	{
+		file->onLoadComplete();
+		return;
+	}
+	if ( abortFlag )
+		return;
+	cheng4::u64 pos = 0;
+	if ( file->mapData )
+	{
+		bool ok = indexMapped();
+		// the index is usable before the persistent index is built
+		file->onLoadComplete();
+		if ( ok && cacheable )
+			buildCache( fp, file->mapSize );
+		return;
+	}
+
+	QFile lfile( file->fileName );
+	char buf[16384];
 	qint64 fsize = lfile.size();
+	bool ok = 1;
 	if ( !lfile.open(QFile::ReadOnly) )
 	{
 		file->onLoadError();
@@ -88,35 +126,311 @@ void PGNLoadThread::work()
 		if ( nr <= 0 )
 		{
 			if ( nr < 0 )
+			{
 				file->onLoadError();
+				ok = 0;
+			}
 			break;
 		}
 		// feed parser with buffer...
 		if ( !file->parser.parseBuffer(buf, (size_t)nr) )
 		{
 			file->onParseError( (qint64)file->parser.getLine(), file->parser.getError() );
+			ok = 0;
 			break;
 		}
 		pos += nr;
 	}
-	file->parser.flushIndex((cheng4::u64)pos);
+	file->parser.flushIndex(pos);
 	file->onLoadComplete();
+	if ( ok && !abortFlag && cacheable )
+		buildCache( fp, pos );
+}
+
+// use persistent index if up to date
+bool PGNLoadThread::loadCache( const PGNFingerprint &fp )
+{
+	PGNIndexCache *cache = new PGNIndexCache;
+	if ( !cache->open( file->fileName, fp ) )
+	{
+		delete cache;
+		return 0;
+	}
+	vector< PGNIndex > index;
+	cache->getIndex( index );
+	file->onLoadProgress( 100 );
+	// games will be accessed randomly
+	file->adviseMapping( 0 );
+	if ( abortFlag )
+	{
+		// killed while loading => don't publish
+		delete cache;
+		return 0;
+	}
+
+	core::MutexLock _( file->mutex );
+	file->index.swap( index );
+	swap( file->cache, cache );
+	delete cache;
+	return 1;
+}
+
+// build and save persistent index, indexedSize = number of bytes indexed
+void PGNLoadThread::buildCache( const PGNFingerprint &fp, cheng4::u64 indexedSize )
+{
+	PGNIndexCache *cache = new PGNIndexCache;
+	// headers are read in file order
+	file->adviseMapping( 1 );
+	bool ok = cache->build( file->fileName, *file, file->index, fp, indexedSize, &abortFlag );
+	file->adviseMapping( 0 );
+	if ( !ok || abortFlag )
+	{
+		delete cache;
+		return;
+	}
+
+	core::MutexLock _( file->mutex );
+	swap( file->cache, cache );
+	delete cache;
+}
+
+// PGNChunkWorker: indexes one chunk of a memory-mapped file
+
+class PGNChunkWorker : public core::Thread
+{
+public:
+	const char *data;				// mapping
+	cheng4::u64 start, end;			// chunk range
+	volatile bool *abortFlag;		// shared abort flag
+	volatile cheng4::u64 done;		// bytes processed so far
+	volatile bool finished;
+	bool ok;						// 0 = parse error
+	vector< PGNIndex > index;		// chunk index
+	PGNIndexParser parser;
+
+	PGNChunkWorker() : data(0), start(0), end(0), abortFlag(0), done(0), finished(0), ok(1), parser(index)
+	{
+	}
+
+	void work()
+	{
+		parser.reset( start );
+		for ( cheng4::u64 pos = start; pos < end && !*abortFlag; )
+		{
+			size_t nr = (size_t)min( end - pos, (cheng4::u64)mapChunkSize );
+			if ( !parser.parseBuffer( data + pos, nr ) )
+			{
+				ok = 0;
+				break;
+			}
+			pos += nr;
+			done = pos - start;
+		}
+		finished = 1;
+	}
+};
+
+// find likely game start at or after pos: `[' at column 1 that doesn't follow a tag line
+static cheng4::u64 findGameStart( const char *data, cheng4::u64 pos, cheng4::u64 size )
+{
+	while ( pos < size )
+	{
+		const char *p = (const char *)memchr( data + pos, '[', (size_t)(size - pos) );
+		if ( !p )
+			break;
+		pos = (cheng4::u64)(p - data) + 1;
+		if ( p == data || (p[-1] != 10 && p[-1] != 13) )
+			continue;
+		// skip back to previous non-empty line
+		const char *q = p - 1;
+		while ( q > data && (unsigned char)*q <= 32 )
+			q--;
+		while ( q > data && q[-1] != 10 && q[-1] != 13 )
+			q--;
+		if ( *q != '[' )
+			return (cheng4::u64)(p - data);
+	}
+	return size;
+}
+
+// append chunk index, renumbering entries
+static void appendIndex( vector< PGNIndex > &dst, const vector< PGNIndex > &src )
+{
+	for ( size_t i=0; i<src.size(); i++ )
+	{
+		dst.push_back( src[i] );
+		dst.back().index = dst.size()-1;
+	}
+}
+
+// index memory-mapped file using multiple threads
+// the file is split into chunks at likely game starts, each chunk is indexed by a fresh parser
+// and a chunk boundary is accepted only if the preceding chunk ends in a state where a new game can start;
+// otherwise the preceding parser simply continues through the chunk
+bool PGNLoadThread::indexMapped()
+{
+	const char *data = file->mapData;
+	cheng4::u64 size = file->mapSize;
+
+	cheng4::u64 threads = file->indexThreads ? file->indexThreads : core::Thread::cpuCount();
+	threads = min( threads, size / minParallelChunkSize );
+	vector< cheng4::u64 > starts( 1, 0 );
+	for ( cheng4::u64 i=1; i<threads; i++ )
+	{
+		cheng4::u64 start = findGameStart( data, max( size*i/threads, starts.back()+1 ), size );
+		if ( start >= size )
+			break;
+		starts.push_back( start );
+	}
+
+	bool ok = 0;
+	vector< PGNChunkWorker * > workers;
+	for ( size_t i=0; i<starts.size(); i++ )
+	{
+		PGNChunkWorker *w = new PGNChunkWorker;
+		w->data = data;
+		w->start = starts[i];
+		w->end = i+1 < starts.size() ? starts[i+1] : size;
+		w->abortFlag = &abortFlag;
+		workers.push_back( w );
+		w->run();
+	}
+
+	// report progress until all workers are done
+	for (;;)
+	{
+		cheng4::u64 done = 0;
+		bool finished = 1;
+		for ( size_t i=0; i<workers.size(); i++ )
+		{
+			done += workers[i]->done;
+			finished &= workers[i]->finished;
+		}
+		if ( finished )
+			break;
+		file->onLoadProgress( (int)(done*100 / size) );
+		core::Thread::sleep( 10 );
+	}
+	for ( size_t i=0; i<workers.size(); i++ )
+		workers[i]->wait();
+
+	if ( !abortFlag )
+	{
+		// merge chunk indices in order, verifying boundaries
+		vector< PGNIndex > merged;
+		PGNChunkWorker *cur = workers[0];
+		ok = cur->ok;
+		cheng4::u64 lineBase = 0;
+		for ( size_t i=1; ok && i<workers.size(); i++ )
+		{
+			PGNChunkWorker *next = workers[i];
+			if ( cur->parser.atGameStart() )
+			{
+				cur->parser.flushIndex( next->start );
+				appendIndex( merged, cur->index );
+				lineBase += cur->parser.getLine()-1;
+				cur = next;
+				ok = cur->ok;
+				continue;
+			}
+			// false boundary => continue sequentially
+			ok = cur->parser.parseBuffer( data + next->start, (size_t)(next->end - next->start) );
+		}
+		if ( !ok )
+			file->onParseError( (qint64)(lineBase + cur->parser.getLine()), cur->parser.getError() );
+		cur->parser.flushIndex( ok ? size : cur->parser.getOffset() );
+		appendIndex( merged, cur->index );
+		// games will be accessed randomly from now on
+		file->adviseMapping( 0 );
+
+		core::MutexLock _( file->mutex );
+		file->index.swap( merged );
+	}
+
+	for ( size_t i=0; i<workers.size(); i++ )
+		workers[i]->kill();
+	return ok;
 }
 
 // PGNIndexParser
 
+// lexer character classes: bit set = lexer has to look at the character in that state
+enum LexClass
+{
+	lcScan			=	1,
+	lcComment		=	2,
+	lcMultiComment	=	4,
+	lcString		=	8
+};
+
+struct LexTable
+{
+	cheng4::u8 cls[256];
+
+	LexTable()
+	{
+		memset( cls, 0, sizeof(cls) );
+		setClass( "[]\";{%\r\n", lcScan );
+		setClass( "\r\n", lcComment );
+		setClass( "}\r\n", lcMultiComment );
+		setClass( "\"\\", lcString );
+	}
+
+	void setClass( const char *chars, cheng4::u8 c )
+	{
+		while ( *chars )
+			cls[ (unsigned char)*chars++ ] |= c;
+	}
+};
+
+static const LexTable lexTable;
+
+#ifdef PGN_USE_SSE2
+// mask of bytes in v equal to any of n chars
+static inline int lexMask( __m128i v, const char *chars, int n )
+{
+	__m128i m = _mm_cmpeq_epi8( v, _mm_set1_epi8( chars[0] ) );
+	for ( int i=1; i<n; i++ )
+		m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( chars[i] ) ) );
+	return _mm_movemask_epi8( m );
+}
+#endif
+
+// skip characters the lexer doesn't care about in state of class cls
+// chars must list the characters of that class
+// returns pointer to the first interesting character (or top)
+static inline const char *lexSkip( const char *p, const char *top, const char *chars, int n, cheng4::u8 cls )
+{
+#ifdef PGN_USE_SSE2
+	while ( top - p >= 16 )
+	{
+		int mask = lexMask( _mm_loadu_si128( (const __m128i *)p ), chars, n );
+		if ( mask )
+			return p + cheng4::BitOp::getLSB( (cheng4::u64)mask );
+		p += 16;
+	}
+#else
+	(void)chars;
+	(void)n;
+#endif
+	while ( p < top && !(lexTable.cls[ (unsigned char)*p ] & cls) )
+		p++;
+	return p;
+}
+
 PGNIndexParser::PGNIndexParser( vector< PGNIndex > &indexRef ) : index(indexRef)
 {
 	reset();
 }
 
-void PGNIndexParser::reset()
+// reset parser (and index) to start parsing at file offset
+void PGNIndexParser::reset( cheng4::u64 offset )
 {
 	column = line = 1;
 	state = stScan;
 	lexState = lsScan;
 	inTag = 0;
-	ofs = 0;
+	ofs = offset;
 	index.clear();
 	error = "no error";
 }
@@ -126,6 +440,17 @@ cheng4::u64 PGNIndexParser::getLine() const
 	return line;
 }
 
+cheng4::u64 PGNIndexParser::getOffset() const
+{
+	return ofs;
+}
+
+// can a new game start at current position? (used to verify chunk boundaries)
+bool PGNIndexParser::atGameStart() const
+{
+	return (lexState == lsScan || lexState == lsEol) && !inTag && state != stHeader;
+}
+
 QString PGNIndexParser::getError() const
 {
 	return error;
@@ -138,9 +463,13 @@ void PGNIndexParser::flushIndex( cheng4::u64 offset )
 	PGNIndex &idx = index.back();
 	if ( idx.size )
 		return;				// already set
-	idx.size = offset - idx.offset;
-	if ( !idx.size )
+	// after a parse error, offset is the start of the failing buffer which may precede the last game
+	if ( offset <= idx.offset )
+	{
 		index.pop_back();
+		return;
+	}
+	idx.size = offset - idx.offset;
 }
 
 void PGNIndexParser::flushHeader( cheng4::u64 offset )
@@ -167,6 +496,13 @@ bool PGNIndexParser::parseBuffer( const char *buf, size_t sz )
 			column++; buf++;
 			continue;
 		case lsString:
+			{
+				const char *next = lexSkip( buf, top, "\"\\", 2, lcString );
+				column += (cheng4::u64)(next - buf);
+				buf = next;
+				if ( buf >= top )
+					continue;
+			}
 			if ( *buf == '"')
 				lexState = lsScan;
 			else if ( *buf == '\\' )
@@ -184,6 +520,13 @@ bool PGNIndexParser::parseBuffer( const char *buf, size_t sz )
 			lexState = lsMultiComment;
 			continue;
 		case lsComment:
+			{
+				const char *next = lexSkip( buf, top, "\r\n", 2, lcComment );
+				column += (cheng4::u64)(next - buf);
+				buf = next;
+				if ( buf >= top )
+					continue;
+			}
 			if (*buf == 10 || *buf == 13)
 			{
 				// end of lsComment
@@ -193,6 +536,13 @@ bool PGNIndexParser::parseBuffer( const char *buf, size_t sz )
 			buf++;
 			continue;
 		case lsMultiComment:
+			{
+				const char *next = lexSkip( buf, top, "}\r\n", 3, lcMultiComment );
+				column += (cheng4::u64)(next - buf);
+				buf = next;
+				if ( buf >= top )
+					continue;
+			}
 			if (*buf == 10 || *buf == 13)
 			{
 				// end of lsComment
@@ -205,6 +555,15 @@ bool PGNIndexParser::parseBuffer( const char *buf, size_t sz )
 			buf++;
 			continue;
 		case lsScan:
+			// first movetext character after header needs to be seen
+			if ( state != stHeader || inTag )
+			{
+				const char *next = lexSkip( buf, top, "[]\";{%\r\n", 8, lcScan );
+				column += (cheng4::u64)(next - buf);
+				buf = next;
+				if ( buf >= top )
+					continue;
+			}
 			switch( *buf )
 			{
 			case '%':
@@ -287,30 +646,39 @@ bool PGNIndexParser::parseBuffer( const char *buf, size_t sz )
 
 // PGNFile
 
-PGNFile::PGNFile() : utf8(0), loaded(0), thread(0), parser(index)
+PGNFile::PGNFile() : utf8(0), loaded(0), thread(0), mapped(0), mapData(0), mapSize(0), indexThreads(0), useCache(1), cache(0), parser(index)
 {
 }
 
 PGNFile::~PGNFile()
 {
 	killThread();
+	delete cache;
+	unmapFile();
 }
 
 void PGNFile::clear()
 {
 	core::MutexLock _(mutex);
 	parser.reset();
+	delete cache;
+	cache = 0;
 }
 
+// the loader locks mutex to publish results, so it must not be held while waiting for it
 void PGNFile::killThread()
 {
-	core::MutexLock _(mutex);
-	if ( thread )
+	PGNLoadThread *thr;
 	{
-		thread->abort();
-		thread->kill();
+		core::MutexLock _(mutex);
+		thr = thread;
 		thread = 0;
 	}
+	if ( thr )
+	{
+		thr->abort();
+		thr->kill();
+	}
 }
 
 bool PGNFile::load( const QString &fname )
@@ -321,9 +689,14 @@ bool PGNFile::load( const QString &fname )
 		return 0;		// no such file
 	f.close();
 	fileName = fname;
-	thread = new PGNLoadThread;
-	thread->file = this;
-	thread->run();
+	mapFile();
+	PGNLoadThread *thr = new PGNLoadThread;
+	thr->file = this;
+	{
+		core::MutexLock _(mutex);
+		thread = thr;
+	}
+	thr->run();
 	return 1;
 }
 
@@ -359,10 +732,80 @@ bool PGNFile::getIndex( size_t idx, PGNIndex &data )
 	return 1;
 }
 
+// number of threads used to index memory-mapped files (0 = one per CPU)
+void PGNFile::setIndexThreads( cheng4::uint count )
+{
+	indexThreads = count;
+}
+
+// use persistent index (sidecar file next to PGN file), enabled by default
+void PGNFile::setIndexCache( bool enable )
+{
+	useCache = enable;
+}
+
+// memory-map file (falls back to buffered reads if mapping fails)
+bool PGNFile::mapFile()
+{
+	unmapFile();
+	mapped = new QFile( fileName );
+	qint64 size = mapped->size();
+	uchar *ptr = 0;
+	if ( size > 0 && (cheng4::u64)size == (size_t)size && mapped->open( QFile::ReadOnly ) )
+		ptr = mapped->map( 0, size );
+	if ( !ptr )
+	{
+		unmapFile();
+		return 0;
+	}
+	mapData = (const char *)ptr;
+	mapSize = (cheng4::u64)size;
+	adviseMapping( 1 );
+	return 1;
+}
+
+void PGNFile::unmapFile()
+{
+	if ( !mapped )
+		return;
+	if ( mapData )
+		mapped->unmap( (uchar *)mapData );
+	delete mapped;
+	mapped = 0;
+	mapData = 0;
+	mapSize = 0;
+}
+
+// access pattern hint for mapped file
+void PGNFile::adviseMapping( bool sequential )
+{
+#ifndef _WIN32
+	if ( mapData )
+		madvise( (void *)mapData, (size_t)mapSize, sequential ? MADV_SEQUENTIAL : MADV_RANDOM );
+#else
+	(void)sequential;
+#endif
+}
+
+// zero-copy view of raw data (valid until next load), returns 0 if not memory-mapped or out of range
+const char *PGNFile::rawData( cheng4::u64 offset, size_t size ) const
+{
+	if ( !mapData || offset > mapSize || size > mapSize - offset )
+		return 0;
+	return mapData + offset;
+}
+
 // raw low level function to load data
 bool PGNFile::loadRawData( cheng4::u64 offset, size_t size, std::vector< cheng4::u8 > &data )
 {
 	data.clear();
+	if ( const char *view = rawData( offset, size ) )
+	{
+		data.resize(size+1);
+		memcpy( &data.front(), view, size );
+		data[size] = 0;
+		return 1;
+	}
 	QFile f(fileName);
 	if ( !f.open(QFile::ReadOnly) )
 		return 0;
@@ -374,3 +817,94 @@ bool PGNFile::loadRawData( cheng4::u64 offset, size_t size, std::vector< cheng4:
 	data[size] = 0;
 	return 1;
 }
+
+// decode tag string: UTF-8 if valid, Latin-1 otherwise (PGN standard)
+static QString decodeTagString( const string &str )
+{
+	const unsigned char *p = (const unsigned char *)str.c_str();
+	const unsigned char *end = p + str.size();
+	bool valid = 1;
+	while ( valid && p < end )
+	{
+		unsigned char c = *p++;
+		int extra = c < 0x80 ? 0 : (c & 0xe0) == 0xc0 ? 1 : (c & 0xf0) == 0xe0 ? 2 : (c & 0xf8) == 0xf0 ? 3 : -1;
+		if ( extra < 0 || end - p < extra )
+			valid = 0;
+		for ( ; valid && extra > 0; extra-- )
+			valid = (*p++ & 0xc0) == 0x80;
+	}
+	return valid ? QString::fromUtf8( str.c_str(), (int)str.size() )
+		: QString::fromLatin1( str.c_str(), (int)str.size() );
+}
+
+// parse PGN tags starting at text, returns pointer past last tag
+const char *PGNFile::parseHeader( const char *text, const char *end, PGNHeader &hdr )
+{
+	const char *p = text;
+	while ( p < end )
+	{
+		if ( (unsigned char)*p <= 32 )
+		{
+			p++;
+			continue;
+		}
+		if ( *p == ';' || (*p == '%' && (p == text || p[-1] == 10 || p[-1] == 13)) )
+		{
+			// comment/escape line
+			while ( p < end && *p != 10 && *p != 13 )
+				p++;
+			continue;
+		}
+		if ( *p != '[' )
+			break;
+		p++;
+		const char *key = p;
+		while ( p < end && (unsigned char)*p > 32 && *p != '"' && *p != ']' )
+			p++;
+		PGNTag tag;
+		tag.key = QString::fromLatin1( key, (int)(p - key) );
+		while ( p < end && *p != '"' && *p != ']' )
+			p++;
+		string value;
+		if ( p < end && *p == '"' )
+		{
+			for ( p++; p < end && *p != '"'; p++ )
+			{
+				if ( *p == '\\' && p+1 < end )
+					p++;
+				value += *p;
+			}
+		}
+		while ( p < end && *p != ']' )
+			p++;
+		if ( p < end )
+			p++;
+		tag.value = decodeTagString( value );
+		hdr.tags.push_back( tag );
+	}
+	return p;
+}
+
+// load header for corresponding index
+bool PGNFile::loadHeader( const PGNIndex &index, PGNHeader &hdr )
+{
+	hdr.tags.clear();
+	size_t size = index.hdrSize ? index.hdrSize : index.size;
+	const char *text = rawData( index.offset, size );
+	vector< cheng4::u8 > buf;
+	if ( !text )
+	{
+		if ( !loadRawData( index.offset, size, buf ) )
+			return 0;
+		text = (const char *)&buf.front();
+	}
+	parseHeader( text, text + size, hdr );
+	return 1;
+}
+
+// get header field for corresponding index without parsing header
+bool PGNFile::getField( const PGNIndex &index, PGNField field, QString &value ) const
+{
+	core::MutexLock _(mutex);
+	return cache && cache->getField( index.index, field, value );
+}
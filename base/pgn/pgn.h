@@ -33,6 +33,8 @@ freely, subject to the following restrictions:
 #include <map>
 #include <QString>
 
+class QFile;
+
 struct PGNIndex
 {
 	core::u64		offset;		// file offset
@@ -41,24 +43,22 @@ struct PGNIndex
 	size_t			hdrSize;	// header chunk size
 };
 
-// even better would be to collect players and stuff...
-// using indices
-// game index
-// white
-// white elo
-// black
-// black elo
-// event
-// site
-// round
-// date
-// result
-// ECO
-// length
-
-// that would be:
-// 12 indices * 4 = 48 bytes + 4 + 8 = 52+8 = 60 bytes per index (too much)
-// so we'll have to be able to fast-parse header to do sorting
+// header fields extracted into persistent index (see PGNIndexCache)
+// so that game lists can be shown/sorted without parsing headers
+enum PGNField
+{
+	pfEvent,
+	pfSite,
+	pfDate,
+	pfRound,
+	pfWhite,
+	pfBlack,
+	pfResult,
+	pfWhiteElo,
+	pfBlackElo,
+	pfECO,
+	pfCount
+};
 
 struct PGNTag
 {
@@ -71,6 +71,8 @@ struct PGNHeader
 };
 
 class PGNFile;
+class PGNIndexCache;
+struct PGNFingerprint;
 
 class PGNLoadThread : public core::Thread
 {
@@ -84,6 +86,14 @@ public:
 	// abort scanning
 	void abort();
 	void work();
+
+private:
+	// index memory-mapped file using multiple threads, returns 0 on error
+	bool indexMapped();
+	// use persistent index if up to date
+	bool loadCache( const PGNFingerprint &fp );
+	// build and save persistent index
+	void buildCache( const PGNFingerprint &fp, cheng4::u64 indexedSize );
 };
 
 enum PGNResult
@@ -115,7 +125,7 @@ private:
 struct PGNNode
 {
 	PGNNode *parent;					// back link to parent node
-	cheng4::Board board;				// board at this move (wastes space but keeps things simple)
+	cheng4::PackedBoard board;			// packed board at this move
 	QString comment;					// comment associated with this node
 	std::vector< PGNMove > variations;	// variations (variation 0 is main for this node)
 
@@ -171,8 +181,12 @@ class PGNIndexParser
 
 public:
 	PGNIndexParser( std::vector< PGNIndex > &indexRef );
-	void reset();
+	// reset parser (and index) to start parsing at file offset
+	void reset( cheng4::u64 offset = 0 );
 	cheng4::u64 getLine() const;
+	cheng4::u64 getOffset() const;
+	// can a new game start at current position? (used to verify chunk boundaries)
+	bool atGameStart() const;
 	QString getError() const;
 	bool parseBuffer( const char *buf, size_t sz );
 	void flushIndex( cheng4::u64 offset );
@@ -203,15 +217,28 @@ public:
 	// clear PGN file (+reset parser)
 	void clear();
 
+	// number of threads used to index memory-mapped files (0 = one per CPU)
+	void setIndexThreads( cheng4::uint count );
+	// use persistent index (sidecar file next to PGN file), enabled by default
+	void setIndexCache( bool enable );
+
 	// current game count (may change while parsing)
 	size_t getCount() const;
 	// get (sorted) index, returns true on success
 	bool getIndex( size_t idx, PGNIndex &data );
 	// load header for corresponding index
 	bool loadHeader( const PGNIndex &index, PGNHeader &hdr );
+	// get header field for corresponding index without parsing header
+	// returns 0 if persistent index isn't available
+	bool getField( const PGNIndex &index, PGNField field, QString &value ) const;
 
 	// raw low level function to load data
 	bool loadRawData( cheng4::u64 offset, size_t size, std::vector< cheng4::u8 > &data );
+	// zero-copy view of raw data (valid until next load), returns 0 if not memory-mapped or out of range
+	const char *rawData( cheng4::u64 offset, size_t size ) const;
+
+	// parse PGN tags starting at text, returns pointer past last tag
+	static const char *parseHeader( const char *text, const char *end, PGNHeader &hdr );
 
 	// called when (re)loading has started
 	sig::Signal<void> onLoadStarted;
@@ -230,6 +257,12 @@ private:
 	// kill loader thread
 	void killThread();
 
+	// memory-map file (falls back to buffered reads if mapping fails)
+	bool mapFile();
+	void unmapFile();
+	// access pattern hint for mapped file
+	void adviseMapping( bool sequential );
+
 	// parse PGN buffer (and index)
 	bool parseBuffer( const char *buf, size_t sz );
 
@@ -242,6 +275,12 @@ private:
 	bool loaded;						// already loaded
 	PGNLoadThread *thread;				// loader thread
 	QString fileName;					// associated filename
+	QFile *mapped;						// memory-mapped file (0 if none)
+	const char *mapData;				// mapping
+	cheng4::u64 mapSize;				// mapping size
+	cheng4::uint indexThreads;			// indexing threads (0 = one per CPU)
+	bool useCache;						// use persistent index
+	PGNIndexCache *cache;				// persistent index (0 if none)
 	PGNIndexParser parser;				// index parser
 	mutable core::Mutex mutex;
 };
@@ -0,0 +1,732 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "pgnbinary.h"
+#include "../chess/magic.h"
+#include <QFile>
+#include <string.h>
+#include <stdio.h>
+
+using namespace std;
+
+static const char binaryMagic[4] = { 'L', 'V', 'B', 'G' };
+
+enum
+{
+	bfResultMask	=	3,
+	bfCustomStart	=	4
+};
+
+// varint/packed board helpers
+
+static void putVarint( vector< cheng4::u8 > &out, cheng4::u64 v )
+{
+	while ( v >= 0x80 )
+	{
+		out.push_back( (cheng4::u8)(v | 0x80) );
+		v >>= 7;
+	}
+	out.push_back( (cheng4::u8)v );
+}
+
+static bool getVarint( const cheng4::u8 *&ptr, const cheng4::u8 *end, cheng4::u64 &v )
+{
+	v = 0;
+	for ( cheng4::uint shift = 0; ptr < end && shift < 64; shift += 7 )
+	{
+		cheng4::u8 b = *ptr++;
+		v |= (cheng4::u64)(b & 0x7f) << shift;
+		if ( !(b & 0x80) )
+			return 1;
+	}
+	return 0;
+}
+
+static void putPacked( vector< cheng4::u8 > &out, const cheng4::PackedBoard &pb )
+{
+	for ( cheng4::uint i=0; i<8; i++ )
+		out.push_back( (cheng4::u8)(pb.occ >> (8*i)) );
+	out.insert( out.end(), pb.pieces, pb.pieces + sizeof(pb.pieces) );
+	out.push_back( pb.turnEp );
+	out.push_back( pb.fifty );
+	out.push_back( pb.castRights[0] );
+	out.push_back( pb.castRights[1] );
+	out.push_back( (cheng4::u8)(pb.move & 255) );
+	out.push_back( (cheng4::u8)(pb.move >> 8) );
+	out.push_back( pb.flags );
+	out.push_back( pb.reserved );
+}
+
+static bool getPacked( const cheng4::u8 *&ptr, const cheng4::u8 *end, cheng4::PackedBoard &pb )
+{
+	if ( end - ptr < 32 )
+		return 0;
+	pb.occ = 0;
+	for ( cheng4::uint i=0; i<8; i++ )
+		pb.occ |= (cheng4::u64)ptr[i] << (8*i);
+	ptr += 8;
+	memcpy( pb.pieces, ptr, sizeof(pb.pieces) );
+	ptr += sizeof(pb.pieces);
+	pb.turnEp = *ptr++;
+	pb.fifty = *ptr++;
+	pb.castRights[0] = *ptr++;
+	pb.castRights[1] = *ptr++;
+	pb.move = (cheng4::u16)(ptr[0] | (ptr[1] << 8));
+	ptr += 2;
+	pb.flags = *ptr++;
+	pb.reserved = *ptr++;
+	return 1;
+}
+
+// move index coding
+
+// hardware popcount if available (only known at runtime)
+static inline cheng4::uint countBits( cheng4::Bitboard b )
+{
+	using namespace cheng4;
+	return BitOp::hasHwPopCount() ? BitOp::popCount< pcmHardware >( b ) : BitOp::popCount( b );
+}
+
+// pseudolegal moves of a single piece ordered by (to, promotion, castling)
+struct PieceTargets
+{
+	cheng4::Bitboard targets;			// normal target squares
+	cheng4::uint mult;					// 4 for promotions (N, B, R, Q), 1 otherwise
+	cheng4::uint castCount;				// number of castling moves (king only)
+	cheng4::Square castTarget[2];		// castling king targets (ascending)
+
+	inline cheng4::uint count() const
+	{
+		return countBits( targets ) * mult + castCount;
+	}
+};
+
+// stm piece at sq
+static void pieceTargets( const cheng4::Board &b, cheng4::Square sq, PieceTargets &pt )
+{
+	using namespace cheng4;
+	Color c = b.turn();
+	Bitboard occ = b.occupied();
+	Bitboard own = b.occupied( c );
+	pt.targets = 0;
+	pt.mult = 1;
+	pt.castCount = 0;
+
+	switch( PiecePack::type( b.piece( sq ) ) )
+	{
+	case ptPawn:
+		{
+			Bitboard opp = b.occupied( flip( c ) );
+			if ( b.epSquare() )
+				opp |= BitOp::oneShl( b.epSquare() );
+			Bitboard push = BitOp::shiftForward( c, BitOp::oneShl( sq ) ) & ~occ;
+			pt.targets = (Tables::pawnAttm[ c ][ sq ] & opp) | push;
+			if ( push && SquarePack::relRank( c, sq ) == RANK2 )
+				pt.targets |= BitOp::shiftForward( c, push ) & ~occ;
+			if ( SquarePack::relRank( c, sq ) == RANK7 )
+				pt.mult = 4;
+		}
+		break;
+	case ptKnight:
+		pt.targets = Tables::knightAttm[ sq ] & ~own;
+		break;
+	case ptBishop:
+		pt.targets = Magic::bishopAttm( sq, occ ) & ~own;
+		break;
+	case ptRook:
+		pt.targets = Magic::rookAttm( sq, occ ) & ~own;
+		break;
+	case ptQueen:
+		pt.targets = Magic::queenAttm( sq, occ ) & ~own;
+		break;
+	case ptKing:
+		{
+			pt.targets = Tables::kingAttm[ sq ] & ~own;
+			CastRights cr = b.castRights( c );
+			if ( CastPack::allowedLong( cr ) )
+				pt.castTarget[ pt.castCount++ ] = SquarePack::setFile( sq, CFILE );
+			if ( CastPack::allowedShort( cr ) )
+				pt.castTarget[ pt.castCount++ ] = SquarePack::setFile( sq, GFILE );
+		}
+		break;
+	}
+}
+
+// full legality check (as for hash moves)
+static inline bool isLegalMove( const cheng4::Board &b, cheng4::Move m )
+{
+	cheng4::Bitboard pins = b.pins();
+	return b.inCheck() ? b.isLegal< 1, 0 >( m, pins ) : b.isLegal< 0, 0 >( m, pins );
+}
+
+// returns move index or -1 if illegal
+// index = move * pieces + piece, where piece is the index of the moving piece among stm pieces (by square)
+// and move the index among its pseudolegal moves, so only the moving piece needs its targets
+static int encodeMove( const cheng4::Board &b, cheng4::Move m )
+{
+	using namespace cheng4;
+	if ( !isLegalMove( b, m ) )
+		return -1;
+	Square from = MovePack::from( m );
+	Square to = MovePack::to( m );
+
+	Bitboard own = b.occupied( b.turn() );
+	uint pieces = countBits( own );
+	uint piece = countBits( own & (BitOp::oneShl( from ) - 1) );
+
+	PieceTargets pt;
+	pieceTargets( b, from, pt );
+	Bitboard below = pt.targets & (BitOp::oneShl( to ) - 1);
+	if ( MovePack::isCastling( m ) )
+		below |= pt.targets & BitOp::oneShl( to );
+	else if ( !(pt.targets & BitOp::oneShl( to )) )
+		return -1;
+	uint idx = countBits( below ) * pt.mult;
+	if ( MovePack::isPromo( m ) )
+		idx += MovePack::promo( m ) - ptKnight;
+	for ( uint i=0; i<pt.castCount; i++ )
+		idx += pt.castTarget[i] < to;
+	return (int)(idx * pieces + piece);
+}
+
+// returns mcNone if index is out of range or move is illegal
+static cheng4::Move decodeMove( const cheng4::Board &b, cheng4::uint idx )
+{
+	using namespace cheng4;
+	Bitboard own = b.occupied( b.turn() );
+	uint pieces = countBits( own );
+	if ( !pieces )
+		return mcNone;
+	for ( uint piece = idx % pieces; piece; piece-- )
+		own &= own - 1;
+	idx /= pieces;
+	Square from = (Square)BitOp::getLSB( own );
+
+	PieceTargets pt;
+	pieceTargets( b, from, pt );
+	if ( idx >= pt.count() )
+		return mcNone;
+
+	Bitboard targets = pt.targets;
+	for ( uint ci = 0;; )
+	{
+		Square to = targets ? (Square)BitOp::getLSB( targets ) : 64;
+		if ( ci < pt.castCount && pt.castTarget[ ci ] < to )
+		{
+			if ( !idx )
+			{
+				Move m = MovePack::initCastling( from, pt.castTarget[ ci ] );
+				return isLegalMove( b, m ) ? m : mcNone;
+			}
+			idx--;
+			ci++;
+			continue;
+		}
+		BitOp::popBit( targets );
+		if ( idx >= pt.mult )
+		{
+			idx -= pt.mult;
+			continue;
+		}
+		Move m;
+		if ( PiecePack::type( b.piece( from ) ) == ptPawn && to == b.epSquare() && b.epSquare() )
+			m = MovePack::initEpCapture( from, to );
+		else if ( b.piece( to ) != ptNone )
+			m = MovePack::initCapture( from, to );
+		else
+			m = MovePack::init( from, to );
+		if ( pt.mult > 1 )
+			m |= (Move)(ptKnight + idx) << msPromo;
+		return isLegalMove( b, m ) ? m : mcNone;
+	}
+}
+
+static void playMove( cheng4::Board &b, cheng4::Move m )
+{
+	cheng4::UndoInfo ui;
+	b.doMove( m, ui, b.isCheck( m, b.discovered() ) );
+	if ( b.turn() == cheng4::ctWhite )
+		b.incMove();
+}
+
+// PGN text helpers
+
+static bool isSeparator( char c )
+{
+	return (unsigned char)c <= 32 || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '$';
+}
+
+// parse result token, returns length (0 if not a result)
+static size_t parseResult( const char *p, const char *end, PGNResult &res )
+{
+	static const struct
+	{
+		const char *text;
+		PGNResult result;
+	} results[] =
+	{
+		{ "1-0", prWhiteWon },
+		{ "0-1", prBlackWon },
+		{ "1/2-1/2", prDraw },
+		{ "*", prUndetermined }
+	};
+	for ( size_t i=0; i<sizeof(results)/sizeof(results[0]); i++ )
+	{
+		size_t len = strlen( results[i].text );
+		if ( (size_t)(end - p) >= len && !memcmp( p, results[i].text, len ) &&
+			(p + len == end || isSeparator( p[len] )) )
+		{
+			res = results[i].result;
+			return len;
+		}
+	}
+	return 0;
+}
+
+static const char *resultText( PGNResult res )
+{
+	switch( res )
+	{
+	case prWhiteWon:
+		return "1-0";
+	case prBlackWon:
+		return "0-1";
+	case prDraw:
+		return "1/2-1/2";
+	default:
+		return "*";
+	}
+}
+
+// skip {} comment, ; comment or (nested) variation at p
+static const char *skipComment( const char *p, const char *end )
+{
+	if ( *p == '{' )
+	{
+		while ( p < end && *p != '}' )
+			p++;
+		return p < end ? p+1 : p;
+	}
+	if ( *p == ';' )
+	{
+		while ( p < end && *p != 10 && *p != 13 )
+			p++;
+		return p;
+	}
+	// variation
+	int depth = 0;
+	while ( p < end )
+	{
+		char c = *p;
+		if ( c == '{' || c == ';' )
+		{
+			p = skipComment( p, end );
+			continue;
+		}
+		p++;
+		if ( c == '(' )
+			depth++;
+		else if ( c == ')' && !--depth )
+			break;
+	}
+	return p;
+}
+
+// PGNBinaryGame
+
+PGNBinaryGame::PGNBinaryGame() : result(prUndetermined)
+{
+	start.reset();
+}
+
+void PGNBinaryGame::clear()
+{
+	header.tags.clear();
+	start.reset();
+	moves.clear();
+	result = prUndetermined;
+}
+
+// parse PGN game text (tags and movetext); comments, NAGs and variations are dropped
+bool PGNBinaryGame::fromPGN( const char *text, size_t size )
+{
+	clear();
+	const char *p = text;
+	const char *end = text + size;
+
+	// tags
+	p = PGNFile::parseHeader( p, end, header );
+	QByteArray fen;
+	bool hasResult = 0;
+	for ( size_t i=0; i<header.tags.size(); i++ )
+	{
+		const PGNTag &tag = header.tags[i];
+		if ( tag.key == "FEN" )
+			fen = tag.value.toLatin1();
+		else if ( tag.key == "Result" )
+		{
+			QByteArray value = tag.value.toLatin1();
+			hasResult = parseResult( value.constData(), value.constData() + value.size(), result ) != 0;
+		}
+	}
+
+	if ( !fen.isEmpty() && !start.fromFEN( fen.constData() ) )
+		return 0;
+
+	// movetext
+	cheng4::Board b( start );
+	while ( p < end )
+	{
+		char c = *p;
+		if ( (unsigned char)c <= 32 || c == '.' || c == ')' || c == '}' )
+		{
+			p++;
+			continue;
+		}
+		if ( c == '{' || c == ';' || c == '(' )
+		{
+			p = skipComment( p, end );
+			continue;
+		}
+		if ( c == '$' )
+		{
+			for ( p++; p < end && *p >= '0' && *p <= '9'; p++ )
+				;
+			continue;
+		}
+		PGNResult res;
+		if ( parseResult( p, end, res ) )
+		{
+			// result terminates movetext (tag takes precedence)
+			if ( !hasResult )
+				result = res;
+			break;
+		}
+		if ( c >= '1' && c <= '9' )
+		{
+			// move number
+			while ( p < end && *p >= '0' && *p <= '9' )
+				p++;
+			continue;
+		}
+		char tok[16];
+		size_t len = 0;
+		while ( p < end && !isSeparator( *p ) && *p != '.' )
+		{
+			if ( len < sizeof(tok)-1 )
+				tok[ len++ ] = *p;
+			p++;
+		}
+		tok[ len ] = 0;
+		if ( tok[0] == '0' )
+		{
+			// castling using zeroes
+			for ( size_t i=0; i<len; i++ )
+				if ( tok[i] == '0' )
+					tok[i] = 'O';
+		}
+		const char *tp = tok;
+		cheng4::Move m = b.fromSAN( tp );
+		if ( m == cheng4::mcNone )
+			return 0;
+		moves.push_back( m );
+		playMove( b, m );
+	}
+	return 1;
+}
+
+// format as PGN
+QString PGNBinaryGame::toPGN() const
+{
+	QString res;
+	for ( size_t i=0; i<header.tags.size(); i++ )
+	{
+		const PGNTag &tag = header.tags[i];
+		res += '[';
+		res += tag.key;
+		res += " \"";
+		for ( int j=0; j<tag.value.length(); j++ )
+		{
+			QChar c = tag.value[j];
+			if ( c.unicode() == '"' || c.unicode() == '\\' )
+				res += '\\';
+			res += c;
+		}
+		res += "\"]\n";
+	}
+	res += '\n';
+
+	cheng4::Board tb( start );
+	QString line;
+	for ( size_t i=0; i<moves.size(); i++ )
+	{
+		char buf[64];
+		char *dst = buf;
+		if ( !i || tb.turn() == cheng4::ctWhite )
+			dst += sprintf( dst, tb.turn() == cheng4::ctWhite ? "%u." : "%u...", tb.move() );
+		*tb.toSAN( dst, moves[i] ) = 0;
+
+		if ( line.length() + (int)strlen( buf ) > 80 )
+		{
+			res += line;
+			res += '\n';
+			line = QLatin1String( buf );
+		}
+		else
+			line += QLatin1String( buf );
+		line += ' ';
+		playMove( tb, moves[i] );
+	}
+	res += line;
+	res += resultText( result );
+	res += '\n';
+	return res;
+}
+
+// PGNBinaryWriter
+
+PGNBinaryWriter::PGNBinaryWriter() : count(0)
+{
+}
+
+void PGNBinaryWriter::clear()
+{
+	strings.clear();
+	stringMap.clear();
+	games.clear();
+	count = 0;
+}
+
+cheng4::u32 PGNBinaryWriter::addString( const QString &str )
+{
+	map< QString, cheng4::u32 >::const_iterator it = stringMap.find( str );
+	if ( it != stringMap.end() )
+		return it->second;
+	cheng4::u32 idx = (cheng4::u32)strings.size();
+	strings.push_back( str );
+	stringMap[ str ] = idx;
+	return idx;
+}
+
+// add game, returns 0 if a move is illegal
+bool PGNBinaryWriter::add( const PGNBinaryGame &game )
+{
+	// encode moves first so that nothing is added on failure
+	vector< cheng4::u8 > plies;
+	plies.reserve( game.moves.size() );
+	cheng4::Board b( game.start );
+	for ( size_t i=0; i<game.moves.size(); i++ )
+	{
+		int idx = encodeMove( b, game.moves[i] );
+		if ( idx < 0 )
+			return 0;
+		putVarint( plies, (cheng4::u64)idx );
+		playMove( b, game.moves[i] );
+	}
+
+	const vector< PGNTag > &tags = game.header.tags;
+	putVarint( games, tags.size() );
+	for ( size_t i=0; i<tags.size(); i++ )
+	{
+		putVarint( games, addString( tags[i].key ) );
+		putVarint( games, addString( tags[i].value ) );
+	}
+
+	cheng4::Board initial;
+	initial.reset();
+	cheng4::PackedBoard pb, ipb;
+	game.start.pack( pb );
+	initial.pack( ipb );
+	bool custom = pb != ipb;
+
+	games.push_back( (cheng4::u8)((game.result & bfResultMask) | (custom ? bfCustomStart : 0)) );
+	if ( custom )
+		putPacked( games, pb );
+	putVarint( games, game.moves.size() );
+	games.insert( games.end(), plies.begin(), plies.end() );
+	count++;
+	return 1;
+}
+
+size_t PGNBinaryWriter::getCount() const
+{
+	return count;
+}
+
+// serialize archive
+void PGNBinaryWriter::write( vector< cheng4::u8 > &out ) const
+{
+	out.clear();
+	out.insert( out.end(), binaryMagic, binaryMagic + 4 );
+	out.push_back( PGNBinaryReader::VERSION );
+	out.push_back( 0 );
+	out.push_back( 0 );
+	out.push_back( 0 );
+	putVarint( out, strings.size() );
+	for ( size_t i=0; i<strings.size(); i++ )
+	{
+		QByteArray utf8 = strings[i].toUtf8();
+		putVarint( out, (cheng4::u64)utf8.size() );
+		out.insert( out.end(), utf8.constData(), utf8.constData() + utf8.size() );
+	}
+	putVarint( out, count );
+	out.insert( out.end(), games.begin(), games.end() );
+}
+
+// save archive
+bool PGNBinaryWriter::save( const QString &fname ) const
+{
+	vector< cheng4::u8 > data;
+	write( data );
+	QFile f( fname );
+	if ( !f.open( QFile::WriteOnly ) )
+		return 0;
+	return f.write( (const char *)&data.front(), (qint64)data.size() ) == (qint64)data.size();
+}
+
+// PGNBinaryReader
+
+// load archive, returns 0 on error
+bool PGNBinaryReader::load( const QString &fname )
+{
+	buffer.clear();
+	QFile f( fname );
+	if ( !f.open( QFile::ReadOnly ) )
+		return 0;
+	qint64 size = f.size();
+	buffer.resize( (size_t)size );
+	if ( size && f.read( (char *)&buffer.front(), size ) != size )
+		return 0;
+	return parse();
+}
+
+// use archive in memory, returns 0 on error
+bool PGNBinaryReader::setData( const vector< cheng4::u8 > &data )
+{
+	buffer = data;
+	return parse();
+}
+
+bool PGNBinaryReader::parse()
+{
+	strings.clear();
+	offsets.clear();
+	if ( buffer.size() < 8 || memcmp( &buffer[0], binaryMagic, 4 ) || buffer[4] != VERSION )
+		return 0;
+	const cheng4::u8 *base = &buffer[0];
+	const cheng4::u8 *p = base + 8;
+	const cheng4::u8 *end = base + buffer.size();
+
+	cheng4::u64 n, len;
+	if ( !getVarint( p, end, n ) )
+		return 0;
+	for ( cheng4::u64 i=0; i<n; i++ )
+	{
+		if ( !getVarint( p, end, len ) || len > (cheng4::u64)(end - p) )
+			return 0;
+		strings.push_back( QString::fromUtf8( (const char *)p, (int)len ) );
+		p += len;
+	}
+
+	if ( !getVarint( p, end, n ) )
+		return 0;
+	offsets.reserve( (size_t)min( n, (cheng4::u64)(end - p) ) );
+	for ( cheng4::u64 i=0; i<n; i++ )
+	{
+		offsets.push_back( (size_t)(p - base) );
+		cheng4::u64 tags, v;
+		if ( !getVarint( p, end, tags ) )
+			return 0;
+		for ( cheng4::u64 j=0; j<2*tags; j++ )
+			if ( !getVarint( p, end, v ) )
+				return 0;
+		if ( p >= end )
+			return 0;
+		if ( *p++ & bfCustomStart )
+			p += 32;
+		if ( p > end || !getVarint( p, end, len ) || len > (cheng4::u64)(end - p) )
+			return 0;
+		for ( cheng4::u64 j=0; j<len; j++ )
+			if ( !getVarint( p, end, v ) )
+				return 0;
+	}
+	return 1;
+}
+
+size_t PGNBinaryReader::getCount() const
+{
+	return offsets.size();
+}
+
+// decode game
+bool PGNBinaryReader::getGame( size_t index, PGNBinaryGame &game, bool tags ) const
+{
+	game.clear();
+	if ( index >= offsets.size() )
+		return 0;
+	const cheng4::u8 *p = &buffer[0] + offsets[index];
+	const cheng4::u8 *end = &buffer[0] + buffer.size();
+
+	// bounds were validated in parse
+	cheng4::u64 n, key, value;
+	getVarint( p, end, n );
+	for ( cheng4::u64 i=0; i<n; i++ )
+	{
+		getVarint( p, end, key );
+		getVarint( p, end, value );
+		if ( !tags )
+			continue;
+		if ( key >= strings.size() || value >= strings.size() )
+			return 0;
+		PGNTag tag;
+		tag.key = strings[ (size_t)key ];
+		tag.value = strings[ (size_t)value ];
+		game.header.tags.push_back( tag );
+	}
+
+	cheng4::u8 flags = *p++;
+	game.result = (PGNResult)(flags & bfResultMask);
+	if ( flags & bfCustomStart )
+	{
+		cheng4::PackedBoard pb;
+		if ( !getPacked( p, end, pb ) || !game.start.unpack( pb ) )
+			return 0;
+	}
+
+	getVarint( p, end, n );
+	game.moves.reserve( (size_t)n );
+	cheng4::Board b( game.start );
+	for ( cheng4::u64 i=0; i<n; i++ )
+	{
+		cheng4::u64 idx;
+		getVarint( p, end, idx );
+		cheng4::Move m = idx == (cheng4::uint)idx ? decodeMove( b, (cheng4::uint)idx ) : cheng4::mcNone;
+		if ( m == cheng4::mcNone )
+			return 0;
+		game.moves.push_back( m );
+		playMove( b, m );
+	}
+	return 1;
+}
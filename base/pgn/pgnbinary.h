@@ -0,0 +1,119 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#pragma once
+
+#include "pgn.h"
+#include <vector>
+#include <map>
+#include <QString>
+
+// compact binary game archive
+//
+// file layout (all integers are LEB128 varints unless noted):
+//   "LVBG", version (u8), 3 reserved bytes
+//   string count, strings (length + UTF-8 bytes)
+//   game count, games
+// game record:
+//   tag count, (key string index, value string index) * tag count
+//   flags (u8): bits 0-1 PGNResult, bit 2 custom start position follows
+//   [custom start: PackedBoard, 32 bytes, multi-byte fields little endian]
+//   ply count, one varint per ply
+// each ply is move * pieces + piece: piece is the index of the moving piece among pieces of the side to move
+// (ascending squares), pieces their count and move the index among pseudolegal moves of that piece ordered by
+// (to, promotion, castling); it doesn't depend on move generation order, decoding needs no SAN parsing and only
+// the target mask of the moving piece
+// a ply takes one byte while move * pieces + piece < 128, i.e. with 14-16 pieces any move with index 8+ takes two
+// (1.2% of plies on the random test games, 1.2-1.3 bytes/ply overall including tags)
+struct PGNBinaryGame
+{
+	PGNHeader header;					// tags (verbatim, including FEN/SetUp if any)
+	cheng4::Board start;				// starting position
+	std::vector< cheng4::Move > moves;	// main line
+	PGNResult result;					// game result
+
+	PGNBinaryGame();
+
+	void clear();
+
+	// parse PGN game text (tags and movetext); comments, NAGs and variations are dropped
+	// returns 0 on error (bad FEN, illegal or unparsable move)
+	bool fromPGN( const char *text, size_t size );
+
+	// format as PGN
+	QString toPGN() const;
+};
+
+class PGNBinaryWriter
+{
+public:
+	PGNBinaryWriter();
+
+	void clear();
+
+	// add game, returns 0 if a move is illegal
+	bool add( const PGNBinaryGame &game );
+
+	size_t getCount() const;
+
+	// serialize archive
+	void write( std::vector< cheng4::u8 > &out ) const;
+	// save archive
+	bool save( const QString &fname ) const;
+
+private:
+	std::vector< QString > strings;
+	std::map< QString, cheng4::u32 > stringMap;
+	std::vector< cheng4::u8 > games;	// encoded game records
+	size_t count;
+
+	cheng4::u32 addString( const QString &str );
+};
+
+class PGNBinaryReader
+{
+public:
+	enum
+	{
+		VERSION = 2
+	};
+
+	// load archive, returns 0 on error
+	bool load( const QString &fname );
+	// use archive in memory, returns 0 on error
+	bool setData( const std::vector< cheng4::u8 > &data );
+
+	size_t getCount() const;
+
+	// decode game (tags are optional so that replaying moves alone is as fast as possible)
+	bool getGame( size_t index, PGNBinaryGame &game, bool tags = 1 ) const;
+
+private:
+	std::vector< cheng4::u8 > buffer;
+	std::vector< QString > strings;
+	std::vector< size_t > offsets;		// game record offsets into buffer
+
+	bool parse();
+};
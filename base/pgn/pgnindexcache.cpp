@@ -0,0 +1,386 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "pgnindexcache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QByteArray>
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+static const char cacheMagic[4] = { 'L', 'V', 'P', 'I' };
+
+static const size_t headerSize = 64;
+static const size_t recordSize = 16 + 4*pfCount;
+// bytes checksummed at each end of PGN file
+static const cheng4::u64 checksumBlock = 65536;
+
+// tag names of PGNField
+static const char *fieldTags[ pfCount ] =
+{
+	"Event", "Site", "Date", "Round", "White", "Black", "Result", "WhiteElo", "BlackElo", "ECO"
+};
+
+// little endian helpers
+
+static void putU32( cheng4::u8 *p, cheng4::u32 v )
+{
+	for ( cheng4::uint i=0; i<4; i++ )
+		p[i] = (cheng4::u8)(v >> (8*i));
+}
+
+static void putU64( cheng4::u8 *p, cheng4::u64 v )
+{
+	for ( cheng4::uint i=0; i<8; i++ )
+		p[i] = (cheng4::u8)(v >> (8*i));
+}
+
+static cheng4::u32 getU32( const cheng4::u8 *p )
+{
+	return (cheng4::u32)p[0] | ((cheng4::u32)p[1] << 8) | ((cheng4::u32)p[2] << 16) | ((cheng4::u32)p[3] << 24);
+}
+
+static cheng4::u64 getU64( const cheng4::u8 *p )
+{
+	return (cheng4::u64)getU32( p ) | ((cheng4::u64)getU32( p+4 ) << 32);
+}
+
+// FNV-1a
+static cheng4::u64 hashBytes( const char *p, size_t size, cheng4::u64 h = 0xcbf29ce484222325ULL )
+{
+	for ( size_t i=0; i<size; i++ )
+	{
+		h ^= (cheng4::u8)p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+// deduplicated string pool (open addressing, table holds pool offsets, 0 = free)
+class StringPool
+{
+public:
+	vector< char > chars;
+
+	StringPool() : chars( 1, 0 ), table( 1024, 0 ), used(0)
+	{
+	}
+
+	// add string, returns pool offset (0 = empty string or pool full)
+	cheng4::u32 add( const char *str, size_t len )
+	{
+		if ( !len || chars.size() + len + 1 > 0xffffffffu )
+			return 0;
+		size_t mask = table.size()-1;
+		size_t i = (size_t)hashBytes( str, len ) & mask;
+		for ( ; table[i]; i = (i+1) & mask )
+		{
+			const char *s = &chars[ table[i] ];
+			if ( !memcmp( s, str, len ) && !s[len] )
+				return table[i];
+		}
+		cheng4::u32 res = (cheng4::u32)chars.size();
+		chars.insert( chars.end(), str, str + len );
+		chars.push_back( 0 );
+		table[i] = res;
+		if ( ++used * 2 >= table.size() )
+			grow();
+		return res;
+	}
+
+private:
+	vector< cheng4::u32 > table;
+	size_t used;
+
+	void grow()
+	{
+		vector< cheng4::u32 > old( table.size()*2, 0 );
+		old.swap( table );
+		size_t mask = table.size()-1;
+		for ( size_t j=0; j<old.size(); j++ )
+		{
+			if ( !old[j] )
+				continue;
+			const char *s = &chars[ old[j] ];
+			size_t i = (size_t)hashBytes( s, strlen(s) ) & mask;
+			while ( table[i] )
+				i = (i+1) & mask;
+			table[i] = old[j];
+		}
+	}
+};
+
+// PGNFingerprint
+
+PGNFingerprint::PGNFingerprint() : size(0), modified(0), checksum(0)
+{
+}
+
+bool PGNFingerprint::operator ==( const PGNFingerprint &o ) const
+{
+	return size == o.size && modified == o.modified && checksum == o.checksum;
+}
+
+// PGNIndexCache
+
+PGNIndexCache::PGNIndexCache() : mapped(0), data(0), size(0), count(0), strings(0), stringSize(0)
+{
+}
+
+PGNIndexCache::~PGNIndexCache()
+{
+	close();
+}
+
+// sidecar file name for PGN file
+QString PGNIndexCache::cacheFileName( const QString &pgnName )
+{
+	return pgnName + ".lvi";
+}
+
+// get fingerprint of PGN file, data/dataSize is file mapping if memory-mapped (or 0)
+bool PGNIndexCache::fingerprint( const QString &pgnName, const char *data, cheng4::u64 dataSize, PGNFingerprint &fp )
+{
+	QFile f( pgnName );
+	if ( !data && !f.open( QFile::ReadOnly ) )
+		return 0;
+	// the file may have changed since it was mapped
+	fp.size = data ? dataSize : (cheng4::u64)f.size();
+	fp.modified = (cheng4::u64)QFileInfo( pgnName ).lastModified().toMSecsSinceEpoch();
+
+	cheng4::u64 headSize = min( fp.size, checksumBlock );
+	cheng4::u64 tailStart = max( headSize, fp.size - min( fp.size, checksumBlock ) );
+	cheng4::u64 tailSize = fp.size - tailStart;
+	if ( data )
+	{
+		fp.checksum = hashBytes( data, (size_t)headSize );
+		fp.checksum = hashBytes( data + tailStart, (size_t)tailSize, fp.checksum );
+		return 1;
+	}
+	vector< char > buf( (size_t)checksumBlock );
+	if ( f.read( &buf.front(), (qint64)headSize ) != (qint64)headSize )
+		return 0;
+	fp.checksum = hashBytes( &buf.front(), (size_t)headSize );
+	if ( tailSize )
+	{
+		if ( !f.seek( (qint64)tailStart ) || f.read( &buf.front(), (qint64)tailSize ) != (qint64)tailSize )
+			return 0;
+		fp.checksum = hashBytes( &buf.front(), (size_t)tailSize, fp.checksum );
+	}
+	return 1;
+}
+
+// open (memory-map) sidecar, returns 0 if missing, stale or corrupt
+bool PGNIndexCache::open( const QString &pgnName, const PGNFingerprint &fp )
+{
+	close();
+	mapped = new QFile( cacheFileName( pgnName ) );
+	qint64 sz = mapped->size();
+	uchar *ptr = 0;
+	if ( sz >= (qint64)headerSize && (cheng4::u64)sz == (size_t)sz && mapped->open( QFile::ReadOnly ) )
+		ptr = mapped->map( 0, sz );
+	if ( !ptr )
+	{
+		close();
+		return 0;
+	}
+	data = (const cheng4::u8 *)ptr;
+	size = (cheng4::u64)sz;
+	if ( !parse( fp ) )
+	{
+		close();
+		return 0;
+	}
+	return 1;
+}
+
+// build from index (extracting header fields) and save sidecar
+bool PGNIndexCache::build( const QString &pgnName, PGNFile &file, const vector< PGNIndex > &index,
+	const PGNFingerprint &fp, cheng4::u64 indexedSize, const volatile bool *abortFlag )
+{
+	close();
+	vector< cheng4::u8 > out( headerSize + index.size() * recordSize, 0 );
+	StringPool pool;
+	PGNHeader hdr;
+	for ( size_t i=0; i<index.size(); i++ )
+	{
+		if ( abortFlag && *abortFlag )
+			return 0;
+		const PGNIndex &idx = index[i];
+		if ( (cheng4::u64)idx.size > 0xffffffffu || !file.loadHeader( idx, hdr ) )
+			return 0;
+		cheng4::u8 *rec = &out[ headerSize + i*recordSize ];
+		putU64( rec, idx.offset );
+		putU32( rec + 8, (cheng4::u32)idx.size );
+		putU32( rec + 12, (cheng4::u32)idx.hdrSize );
+		cheng4::uint found = 0;
+		for ( size_t j=0; j<hdr.tags.size(); j++ )
+		{
+			const PGNTag &tag = hdr.tags[j];
+			for ( cheng4::uint f=0; f<pfCount; f++ )
+			{
+				if ( (found & (1u << f)) || tag.key != QLatin1String( fieldTags[f] ) )
+					continue;
+				// first occurrence wins
+				found |= 1u << f;
+				QByteArray value = tag.value.toUtf8();
+				putU32( rec + 16 + 4*f, pool.add( value.constData(), strlen( value.constData() ) ) );
+				break;
+			}
+		}
+	}
+
+	memcpy( &out[0], cacheMagic, 4 );
+	putU32( &out[4], VERSION );
+	putU64( &out[8], fp.size );
+	putU64( &out[16], fp.modified );
+	putU64( &out[24], fp.checksum );
+	putU64( &out[32], (cheng4::u64)index.size() );
+	putU64( &out[40], (cheng4::u64)out.size() );
+	putU64( &out[48], (cheng4::u64)pool.chars.size() );
+	out.insert( out.end(), pool.chars.begin(), pool.chars.end() );
+
+	// write to temporary file first so that a partial sidecar is never picked up
+	QString cname = cacheFileName( pgnName );
+	QString tmpName = cname + ".tmp";
+	bool saved = 0;
+	// file changed while indexing => fingerprint doesn't describe the index
+	if ( fp.size == indexedSize )
+	{
+		QFile f( tmpName );
+		if ( f.open( QFile::WriteOnly ) )
+			saved = f.write( (const char *)&out.front(), (qint64)out.size() ) == (qint64)out.size();
+	}
+	if ( saved )
+	{
+		QFile::remove( cname );
+		saved = QFile::rename( tmpName, cname );
+	}
+	if ( !saved )
+		QFile::remove( tmpName );
+	else if ( open( pgnName, fp ) )
+		return 1;
+
+	// keep in memory (read-only location or the like)
+	buffer.swap( out );
+	data = &buffer.front();
+	size = (cheng4::u64)buffer.size();
+	return parse( fp );
+}
+
+void PGNIndexCache::close()
+{
+	if ( mapped )
+	{
+		if ( data )
+			mapped->unmap( (uchar *)data );
+		delete mapped;
+		mapped = 0;
+	}
+	buffer.clear();
+	data = 0;
+	size = 0;
+	count = 0;
+	strings = 0;
+	stringSize = 0;
+}
+
+size_t PGNIndexCache::getCount() const
+{
+	return (size_t)count;
+}
+
+// fill index (unsorted)
+void PGNIndexCache::getIndex( vector< PGNIndex > &index ) const
+{
+	index.resize( (size_t)count );
+	for ( size_t i=0; i<index.size(); i++ )
+	{
+		const cheng4::u8 *rec = record( i );
+		PGNIndex &idx = index[i];
+		idx.offset = getU64( rec );
+		idx.index = i;
+		idx.size = getU32( rec + 8 );
+		idx.hdrSize = getU32( rec + 12 );
+	}
+}
+
+// get header field for game (unsorted index), returns 0 if out of range
+bool PGNIndexCache::getField( size_t index, PGNField field, QString &value ) const
+{
+	if ( index >= count || (cheng4::uint)field >= pfCount )
+		return 0;
+	cheng4::u32 ofs = getU32( record( index ) + 16 + 4*field );
+	value = QString::fromUtf8( strings + ofs );
+	return 1;
+}
+
+// validate sidecar data, returns 0 if stale or corrupt
+bool PGNIndexCache::parse( const PGNFingerprint &fp )
+{
+	count = 0;
+	if ( size < headerSize || memcmp( data, cacheMagic, 4 ) || getU32( data+4 ) != VERSION )
+		return 0;
+	PGNFingerprint cfp;
+	cfp.size = getU64( data+8 );
+	cfp.modified = getU64( data+16 );
+	cfp.checksum = getU64( data+24 );
+	if ( !(cfp == fp) )
+		return 0;
+	cheng4::u64 n = getU64( data+32 );
+	cheng4::u64 stringOfs = getU64( data+40 );
+	stringSize = getU64( data+48 );
+	if ( n > (size - headerSize) / recordSize || stringOfs != headerSize + n*recordSize ||
+		!stringSize || stringSize != size - stringOfs || (cheng4::u64)(size_t)n != n )
+		return 0;
+	strings = (const char *)data + stringOfs;
+	if ( strings[0] || strings[stringSize-1] )
+		return 0;
+	// verify records so that the index can be trusted
+	count = n;
+	for ( size_t i=0; i<(size_t)n; i++ )
+	{
+		const cheng4::u8 *rec = record( i );
+		cheng4::u64 offset = getU64( rec );
+		cheng4::u32 gsize = getU32( rec + 8 );
+		bool ok = offset <= fp.size && gsize <= fp.size - offset && getU32( rec + 12 ) <= gsize;
+		for ( cheng4::uint f=0; ok && f<pfCount; f++ )
+			ok = getU32( rec + 16 + 4*f ) < stringSize;
+		if ( !ok )
+		{
+			count = 0;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+const cheng4::u8 *PGNIndexCache::record( size_t index ) const
+{
+	return data + headerSize + index*recordSize;
+}
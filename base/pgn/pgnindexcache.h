@@ -0,0 +1,104 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#pragma once
+
+#include "pgn.h"
+#include <vector>
+#include <QString>
+
+class QFile;
+
+// identifies PGN file contents the persistent index was built for
+struct PGNFingerprint
+{
+	cheng4::u64 size;				// file size
+	cheng4::u64 modified;			// last modification (ms since epoch)
+	cheng4::u64 checksum;			// checksum of file head and tail
+
+	PGNFingerprint();
+
+	bool operator ==( const PGNFingerprint &o ) const;
+};
+
+// persistent PGN index, stored as sidecar file <pgn file>.lvi
+//
+// file layout (little endian, fixed size records so that a memory-mapped file can be used in place):
+//   header (64 bytes):
+//     "LVPI", version (u32)
+//     PGN size, PGN modification time, PGN checksum (u64 each)
+//     game count, string pool offset, string pool size, reserved (u64 each)
+//   game record (56 bytes):
+//     offset (u64), size (u32), header size (u32), pfCount string pool offsets (u32 each)
+//   string pool:
+//     zero-terminated UTF-8 strings (each stored once), offset 0 is empty string
+// the sidecar is only used if size, modification time and checksum of the PGN file match
+class PGNIndexCache
+{
+public:
+	enum
+	{
+		VERSION = 1
+	};
+
+	PGNIndexCache();
+	~PGNIndexCache();
+
+	// sidecar file name for PGN file
+	static QString cacheFileName( const QString &pgnName );
+	// get fingerprint of PGN file, data/dataSize is file mapping if memory-mapped (or 0)
+	// so that the fingerprint describes exactly the bytes that get indexed
+	static bool fingerprint( const QString &pgnName, const char *data, cheng4::u64 dataSize, PGNFingerprint &fp );
+
+	// open (memory-map) sidecar, returns 0 if missing, stale or corrupt
+	bool open( const QString &pgnName, const PGNFingerprint &fp );
+	// build from index (extracting header fields) and save sidecar
+	// indexedSize is the number of PGN bytes the index was built from; the sidecar isn't saved unless it matches fp
+	// the cache is usable even if the sidecar can't be saved; returns 0 if aborted or on read error
+	bool build( const QString &pgnName, PGNFile &file, const std::vector< PGNIndex > &index, const PGNFingerprint &fp,
+		cheng4::u64 indexedSize, const volatile bool *abortFlag = 0 );
+	void close();
+
+	size_t getCount() const;
+	// fill index (unsorted)
+	void getIndex( std::vector< PGNIndex > &index ) const;
+	// get header field for game (unsorted index), returns 0 if out of range
+	bool getField( size_t index, PGNField field, QString &value ) const;
+
+private:
+	QFile *mapped;						// memory-mapped sidecar (0 if none)
+	std::vector< cheng4::u8 > buffer;	// in-memory sidecar (if not mapped)
+	const cheng4::u8 *data;				// sidecar data
+	cheng4::u64 size;					// sidecar size
+	cheng4::u64 count;					// game count
+	const char *strings;				// string pool
+	cheng4::u64 stringSize;				// string pool size
+
+	PGNIndexCache( const PGNIndexCache & ) {}
+
+	// validate sidecar data, returns 0 if stale or corrupt
+	bool parse( const PGNFingerprint &fp );
+	const cheng4::u8 *record( size_t index ) const;
+};
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# livius-bench: chess core microbenchmarks
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+include(../base/base.pri)
+DESTDIR = $$PWD
+
+TARGET = livius-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+unix:LIBS += -lpthread
+
+SOURCES += main.cpp
@@ -0,0 +1,466 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+// livius-bench: chess core microbenchmarks
+//
+// usage: livius-bench [options]
+//   -pgn <file>     add games from PGN file to corpus
+//   -pv <file>      add recorded PVs to corpus (one per line: <fen> | <pv>)
+//   -games <n>      number of generated random games if no corpus given (default: 200)
+//   -reps <n>       measured repetitions (default: 15)
+//   -warmup <n>     warmup repetitions (default: 2)
+//   -filter <str>   only run benchmarks containing str
+//   -json           print results as JSON
+//   -nopext         use magic multiply slider attacks even if BMI2 pext is available
+
+#include "chess/chess.h"
+#include "chess/magic.h"
+#include "core/prng.h"
+#include <QElapsedTimer>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cheng4;
+
+// one corpus entry: position and a legal move in it
+struct Sample
+{
+	Board board;
+	Move move;
+	std::string fen;
+	std::string san;
+	std::string uci;
+};
+
+static std::vector< Sample > corpus;
+
+static void addSample( const Board &b, Move m )
+{
+	Sample s;
+	s.board = b;
+	s.move = m;
+	s.fen = b.toFEN();
+	s.san = b.toSAN( m );
+	s.uci = b.toUCI( m );
+	corpus.push_back( s );
+}
+
+// add move sequence starting at b
+static void addLine( Board b, const char *moves )
+{
+	Move buf[ 1024 ];
+	uint count = b.decodeMoves( moves, buf, 1024 );
+	for ( uint i=0; i<count; i++ )
+	{
+		addSample( b, buf[i] );
+		UndoInfo ui;
+		b.doMove( buf[i], ui, b.isCheck( buf[i], b.discovered() ) );
+		if ( b.turn() == ctWhite )
+			b.incMove();
+	}
+}
+
+// PGN: tag pairs (only FEN is used) followed by movetext
+static bool loadPGN( const char *fname )
+{
+	FILE *f = fopen( fname, "r" );
+	if ( !f )
+		return 0;
+	char line[ 4096 ];
+	std::string movetext;
+	Board start;
+	start.reset();
+	bool inMoves = 0;
+	bool inComment = 0;
+	for (;;)
+	{
+		bool eof = !fgets( line, sizeof(line), f );
+		if ( eof || (line[0] == '[' && inMoves) )
+		{
+			// flush previous game
+			addLine( start, movetext.c_str() );
+			movetext.clear();
+			start.reset();
+			inMoves = 0;
+			if ( eof )
+				break;
+		}
+		if ( line[0] == '[' )
+		{
+			if ( !strncmp( line, "[FEN \"", 6 ) && !start.fromFEN( line+6 ) )
+				start.reset();
+			continue;
+		}
+		// strip {} comments (can span lines) and ; comments
+		inMoves = 1;
+		movetext += ' ';
+		for ( const char *c = line; *c; c++ )
+		{
+			if ( inComment )
+			{
+				inComment = *c != '}';
+				continue;
+			}
+			if ( *c == '{' )
+			{
+				inComment = 1;
+				continue;
+			}
+			if ( *c == ';' )
+				break;
+			movetext += *c;
+		}
+	}
+	fclose( f );
+	return 1;
+}
+
+static bool loadPV( const char *fname )
+{
+	FILE *f = fopen( fname, "r" );
+	if ( !f )
+		return 0;
+	char line[ 4096 ];
+	while ( fgets( line, sizeof(line), f ) )
+	{
+		char *sep = strchr( line, '|' );
+		if ( !sep )
+			continue;
+		*sep++ = 0;
+		Board b;
+		if ( b.fromFEN( line ) )
+			addLine( b, sep );
+	}
+	fclose( f );
+	return 1;
+}
+
+// deterministic random games
+static void generateGames( int games )
+{
+	core::PRNG rng( 1 );
+	for ( int g=0; g<games; g++ )
+	{
+		Board b;
+		b.reset();
+		for ( int ply=0; ply<160; ply++ )
+		{
+			Move moves[ maxMoves ];
+			MoveCount count = MoveGen::generateLegal( b, moves );
+			if ( !count || b.isDraw() )
+				break;
+			Move m = moves[ rng.next64() % count ];
+			addSample( b, m );
+			UndoInfo ui;
+			b.doMove( m, ui, b.isCheck( m, b.discovered() ) );
+			if ( b.turn() == ctWhite )
+				b.incMove();
+		}
+	}
+}
+
+// benchmarks: one pass over corpus, returns checksum (so that the work can't be optimized away)
+
+static u64 benchFromFEN()
+{
+	u64 res = 0;
+	Board b;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		b.fromFEN( corpus[i].fen.c_str() );
+		res += b.sig();
+	}
+	return res;
+}
+
+static u64 benchToFEN()
+{
+	u64 res = 0;
+	char buf[ 256 ];
+	for ( size_t i=0; i<corpus.size(); i++ )
+		res += (u64)(corpus[i].board.toFEN( buf ) - buf);
+	return res;
+}
+
+static u64 benchFromSAN()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		const char *c = corpus[i].san.c_str();
+		res += corpus[i].board.fromSAN( c );
+	}
+	return res;
+}
+
+static u64 benchToSAN()
+{
+	u64 res = 0;
+	char buf[ 64 ];
+	for ( size_t i=0; i<corpus.size(); i++ )
+		res += (u64)(corpus[i].board.toSAN( buf, corpus[i].move ) - buf);
+	return res;
+}
+
+static u64 benchFromUCI()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		const char *c = corpus[i].uci.c_str();
+		res += corpus[i].board.fromUCI( c );
+	}
+	return res;
+}
+
+static u64 benchDoUndo()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		Board &b = corpus[i].board;
+		Move m = corpus[i].move;
+		UndoInfo ui;
+		b.doMove( m, ui, b.isCheck( m, b.discovered() ) );
+		res += b.sig();
+		b.undoMove( ui );
+	}
+	return res;
+}
+
+static u64 benchIsCheck()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		const Board &b = corpus[i].board;
+		res += b.isCheck( corpus[i].move, b.discovered() );
+	}
+	return res;
+}
+
+static u64 benchIsLegal()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		const Board &b = corpus[i].board;
+		Move m = corpus[i].move;
+		res += b.inCheck() ? b.isLegal< 1, 0 >( m, b.pins() ) : b.isLegal< 0, 0 >( m, b.pins() );
+	}
+	return res;
+}
+
+static u64 benchPins()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		const Board &b = corpus[i].board;
+		res += b.pins() ^ b.discovered();
+	}
+	return res;
+}
+
+static u64 benchIsDraw()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+		res += corpus[i].board.isDraw();
+	return res;
+}
+
+static u64 benchMagic()
+{
+	u64 res = 0;
+	for ( size_t i=0; i<corpus.size(); i++ )
+	{
+		Bitboard occ = corpus[i].board.occupied();
+		for ( Square sq = 0; sq < 64; sq++ )
+			res += Magic::rookAttm( sq, occ ) ^ Magic::bishopAttm( sq, occ );
+	}
+	return res;
+}
+
+static u64 benchGenLegal()
+{
+	u64 res = 0;
+	Move moves[ maxMoves ];
+	for ( size_t i=0; i<corpus.size(); i++ )
+		res += MoveGen::generateLegal( corpus[i].board, moves );
+	return res;
+}
+
+struct Benchmark
+{
+	const char *name;
+	u64 (*func)();
+	// operations per corpus entry
+	uint opsPerSample;
+};
+
+static const Benchmark benchmarks[] =
+{
+	{ "fromFEN", benchFromFEN, 1 },
+	{ "toFEN", benchToFEN, 1 },
+	{ "fromSAN", benchFromSAN, 1 },
+	{ "toSAN", benchToSAN, 1 },
+	{ "fromUCI", benchFromUCI, 1 },
+	{ "doMove+undoMove", benchDoUndo, 1 },
+	{ "isCheck", benchIsCheck, 1 },
+	{ "isLegal", benchIsLegal, 1 },
+	{ "pins+discovered", benchPins, 1 },
+	{ "isDraw", benchIsDraw, 1 },
+	{ "Magic::rook+bishopAttm", benchMagic, 64 },
+	{ "MoveGen::generateLegal", benchGenLegal, 1 }
+};
+
+struct Result
+{
+	const char *name;
+	// ns per operation
+	double min, p10, median, p90;
+	u64 checksum;
+};
+
+static double percentile( const std::vector< double > &sorted, double p )
+{
+	size_t idx = (size_t)( p * (double)(sorted.size()-1) + 0.5 );
+	return sorted[ idx ];
+}
+
+static Result run( const Benchmark &bm, int warmup, int reps )
+{
+	Result res;
+	res.name = bm.name;
+	res.checksum = 0;
+	for ( int i=0; i<warmup; i++ )
+		res.checksum += bm.func();
+
+	double ops = (double)corpus.size() * bm.opsPerSample;
+	std::vector< double > times;
+	QElapsedTimer timer;
+	for ( int i=0; i<reps; i++ )
+	{
+		timer.start();
+		res.checksum += bm.func();
+		times.push_back( (double)timer.nsecsElapsed() / ops );
+	}
+	std::sort( times.begin(), times.end() );
+	res.min = times.front();
+	res.p10 = percentile( times, 0.1 );
+	res.median = percentile( times, 0.5 );
+	res.p90 = percentile( times, 0.9 );
+	return res;
+}
+
+int main( int argc, char **argv )
+{
+	ChessInit init;
+	(void)init;
+
+	int games = 200, reps = 15, warmup = 2;
+	const char *filter = 0;
+	bool json = 0;
+
+	for ( int i=1; i<argc; i++ )
+	{
+		bool hasArg = i+1 < argc;
+		if ( !strcmp( argv[i], "-pgn" ) && hasArg )
+		{
+			if ( !loadPGN( argv[++i] ) )
+				fprintf( stderr, "can't open %s\n", argv[i] );
+		}
+		else if ( !strcmp( argv[i], "-pv" ) && hasArg )
+		{
+			if ( !loadPV( argv[++i] ) )
+				fprintf( stderr, "can't open %s\n", argv[i] );
+		}
+		else if ( !strcmp( argv[i], "-games" ) && hasArg )
+			games = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-reps" ) && hasArg )
+			reps = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-warmup" ) && hasArg )
+			warmup = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-filter" ) && hasArg )
+			filter = argv[++i];
+		else if ( !strcmp( argv[i], "-json" ) )
+			json = 1;
+		else if ( !strcmp( argv[i], "-nopext" ) )
+			BitOp::disableHwPext();
+		else
+		{
+			fprintf( stderr, "usage: %s [-pgn <file>] [-pv <file>] [-games <n>] [-reps <n>] [-warmup <n>] "
+				"[-filter <str>] [-json] [-nopext]\n", argv[0] );
+			return 1;
+		}
+	}
+	if ( reps < 1 )
+		reps = 1;
+	if ( corpus.empty() )
+		generateGames( games );
+	if ( corpus.empty() )
+	{
+		fprintf( stderr, "empty corpus\n" );
+		return 1;
+	}
+
+	std::vector< Result > results;
+	for ( size_t i=0; i<sizeof(benchmarks)/sizeof(benchmarks[0]); i++ )
+	{
+		if ( filter && !strstr( benchmarks[i].name, filter ) )
+			continue;
+		results.push_back( run( benchmarks[i], warmup, reps ) );
+	}
+
+	if ( json )
+	{
+		printf( "{\n\t\"samples\": %u,\n\t\"reps\": %d,\n\t\"sliders\": \"%s\",\n\t\"unit\": \"ns/op\",\n"
+			"\t\"results\": [\n", (uint)corpus.size(), reps, BitOp::hasHwPext() ? "pext" : "magic" );
+		for ( size_t i=0; i<results.size(); i++ )
+		{
+			const Result &r = results[i];
+			printf( "\t\t{ \"name\": \"%s\", \"min\": %.2f, \"p10\": %.2f, \"median\": %.2f, \"p90\": %.2f, "
+				"\"checksum\": \"%016llx\" }%s\n", r.name, r.min, r.p10, r.median, r.p90,
+				(unsigned long long)r.checksum, i+1 < results.size() ? "," : "" );
+		}
+		printf( "\t]\n}\n" );
+		return 0;
+	}
+
+	printf( "%u samples, %d reps, %s slider attacks (ns/op)\n", (uint)corpus.size(), reps,
+		BitOp::hasHwPext() ? "pext" : "magic" );
+	printf( "%-24s %10s %10s %10s %10s\n", "benchmark", "min", "p10", "median", "p90" );
+	for ( size_t i=0; i<results.size(); i++ )
+	{
+		const Result &r = results[i];
+		printf( "%-24s %10.2f %10.2f %10.2f %10.2f\n", r.name, r.min, r.p10, r.median, r.p90 );
+	}
+	return 0;
+}
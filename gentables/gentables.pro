@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# livius-gentables: precomputed chess core tables
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+include(../base/base.pri)
+DESTDIR = $$PWD
+
+TARGET = livius-gentables
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp
@@ -0,0 +1,252 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+// livius-gentables: dumps the precomputed chess core tables into a C++ source
+//
+// usage: livius-gentables [output]   (default: gentables.cpp)
+//
+// the output is meant to go to base/chess/gentables.cpp (see make gentables);
+// when present, base is built with LIVIUS_GENTABLES so that attack, magic and Zobrist tables
+// are linked in as read-only data shared between processes and ChessInit has nothing to compute
+
+#include "chess/chess.h"
+#include <stdio.h>
+
+using namespace cheng4;
+
+class TableWriter
+{
+	FILE *f;
+
+	static void put( FILE *f, Bitboard v )
+	{
+		fprintf( f, "U64C(0x%016llx)", (unsigned long long)v );
+	}
+
+	static void put( FILE *f, u8 v )
+	{
+		fprintf( f, "%u", (uint)v );
+	}
+
+	static void put( FILE *f, i8 v )
+	{
+		fprintf( f, "%d", (int)v );
+	}
+
+	static void put( FILE *f, bool v )
+	{
+		fputs( v ? "1" : "0", f );
+	}
+
+	template< typename T > static uint perLine( const T * )
+	{
+		return sizeof(T) >= 8 ? 4 : 24;
+	}
+
+	void indent( uint depth )
+	{
+		while ( depth-- )
+			fputc( '\t', f );
+	}
+
+	// writes nested braced block, advances data
+	template< typename T > void block( const T *&data, const uint *dims, uint ndims, uint depth )
+	{
+		fputs( "{\n", f );
+		if ( ndims == 1 )
+		{
+			const uint pl = perLine( data );
+			for ( uint i=0; i<dims[0]; i++ )
+			{
+				if ( !(i % pl) )
+					indent( depth+1 );
+				put( f, *data++ );
+				if ( i+1 < dims[0] )
+					fputs( (i+1) % pl ? ", " : ",\n", f );
+			}
+			fputc( '\n', f );
+		}
+		else
+		{
+			for ( uint i=0; i<dims[0]; i++ )
+			{
+				indent( depth+1 );
+				block( data, dims+1, ndims-1, depth+1 );
+				fputs( i+1 < dims[0] ? ",\n" : "\n", f );
+			}
+		}
+		indent( depth );
+		fputc( '}', f );
+	}
+public:
+	size_t bytes;
+
+	explicit TableWriter( FILE *f_ ) : f(f_), bytes(0) {}
+
+	void raw( const char *str )
+	{
+		fputs( str, f );
+	}
+
+	// decl: declarator up to the initializer, i.e. "const u8 Tables::popCount8[ 256 ]"
+	template< typename T > void table( const char *decl, const T *data, uint d0, uint d1 = 0, uint d2 = 0 )
+	{
+		uint dims[3] = { d0, d1, d2 };
+		uint ndims = d2 ? 3 : d1 ? 2 : 1;
+		bytes += sizeof(T) * d0 * (d1 ? d1 : 1) * (d2 ? d2 : 1);
+		fprintf( f, "%s = ", decl );
+		block( data, dims, ndims, 0 );
+		fputs( ";\n\n", f );
+	}
+
+	void scalar( const char *decl, Bitboard v )
+	{
+		bytes += sizeof(v);
+		fprintf( f, "%s = ", decl );
+		put( f, v );
+		fputs( ";\n\n", f );
+	}
+
+	void magicEntries( const char *decl, const Magic::Entry *entries )
+	{
+		bytes += 64 * sizeof(Magic::Entry);
+		fprintf( f, "%s = {\n", decl );
+		for ( uint i=0; i<64; i++ )
+		{
+			const Magic::Entry &e = entries[i];
+			indent( 1 );
+			fputs( "{ ", f );
+			put( f, e.mask );
+			fputs( ", ", f );
+			put( f, e.magic );
+			fprintf( f, ", %u, %u, 0 }%s\n", e.offset, e.shift, i < 63 ? "," : "" );
+		}
+		fputs( "};\n\n", f );
+	}
+};
+
+// derived to reach protected tables
+struct TablesDump : Tables
+{
+	static void write( TableWriter &w )
+	{
+		w.table( "const u8 Tables::lsBit16[ 65536 ]", lsBit16, 65536 );
+		w.table( "const u8 Tables::msBit16[ 65536 ]", msBit16, 65536 );
+		w.table( "const u8 Tables::popCount16[ 65536 ]", popCount16, 65536 );
+		w.table( "const u8 Tables::popCount8[ 256 ]", popCount8, 256 );
+		w.table( "const Bitboard Tables::oneShlTab[ 64 ]", oneShlTab, 64 );
+		w.table( "const Bitboard Tables::noneShlTab[ 256 ]", noneShlTab, 256 );
+		w.table( "const Bitboard Tables::kingAttm[ 64 ]", kingAttm, 64 );
+		w.table( "const Bitboard Tables::knightAttm[ 64 ]", knightAttm, 64 );
+		w.table( "const Bitboard Tables::pawnAttm[ 2 ][ 64 ]", &pawnAttm[0][0], 2, 64 );
+		w.table( "const bool Tables::neighbor[ 64 ][ 64 ]", &neighbor[0][0], 64, 64 );
+		w.table( "const u8 Tables::direction[ 64 ][ 64 ]", &direction[0][0], 64, 64 );
+		w.table( "const i8 Tables::advance[ dirMax ]", advance, dirMax );
+		w.table( "const Bitboard Tables::between[ 64 ][ 64 ]", &between[0][0], 64, 64 );
+		w.table( "const Bitboard Tables::ray[ 64 ][ 64 ]", &ray[0][0], 64, 64 );
+		w.table( "const Bitboard Tables::diagAttm[ 64 ]", diagAttm, 64 );
+		w.table( "const Bitboard Tables::orthoAttm[ 64 ]", orthoAttm, 64 );
+		w.table( "const Bitboard Tables::queenAttm[ 64 ]", queenAttm, 64 );
+		w.table( "const Bitboard Tables::passerMask[ 2 ][ 64 ]", &passerMask[0][0], 2, 64 );
+		w.table( "const Bitboard Tables::frontMask[ 2 ][ 64 ]", &frontMask[0][0], 2, 64 );
+		w.table( "const Bitboard Tables::isoMask[ 8 ]", isoMask, 8 );
+		w.table( "const Bitboard Tables::chainMask[ 64 ]", chainMask, 64 );
+		w.table( "const Bitboard Tables::outpostMask[ 2 ][ 64 ]", &outpostMask[0][0], 2, 64 );
+		w.table( "const u8 Tables::moveValid[ 64 ][ 64 ]", &moveValid[0][0], 64, 64 );
+		w.table( "const u8 Tables::distance[ 64 ][ 64 ]", &distance[0][0], 64, 64 );
+		w.table( "const Bitboard Tables::fileMask[ 8 ]", fileMask, 8 );
+	}
+};
+
+struct MagicDump : Magic
+{
+	static void write( TableWriter &w )
+	{
+		w.magicEntries( "CHENG_ALIGN64 const Magic::Entry Magic::rookEntry[ 64 ]", rookEntry );
+		w.magicEntries( "CHENG_ALIGN64 const Magic::Entry Magic::bishopEntry[ 64 ]", bishopEntry );
+		w.table( "CHENG_ALIGN64 const Bitboard Magic::magicAttacks[ Magic::attackTableSize ]", magicAttacks,
+			attackTableSize );
+#ifdef USE_PEXT
+		w.raw( "#ifdef USE_PEXT\n\n" );
+		w.table( "CHENG_ALIGN64 const Bitboard Magic::pextAttacks[ Magic::attackTableSize ]", pextAttacks,
+			attackTableSize );
+		w.raw( "#endif\n\n" );
+#endif
+	}
+};
+
+static void writeZobrist( TableWriter &w )
+{
+	w.scalar( "const Signature Zobrist::turn", Zobrist::turn );
+	w.table( "const Signature Zobrist::epFile[ 8 ]", Zobrist::epFile, 8 );
+	w.table( "const Signature Zobrist::piece[ 2 ][ ptMax ][ 64 ]", &Zobrist::piece[0][0][0], 2, ptMax, 64 );
+	w.table( "const Signature Zobrist::cast[ 2 ][ 0x88+1 ]", &Zobrist::cast[0][0], 2, 0x88+1 );
+	w.scalar( "const Signature Zobrist::turnHi", Zobrist::turnHi );
+	w.table( "const Signature Zobrist::epFileHi[ 8 ]", Zobrist::epFileHi, 8 );
+	w.table( "const Signature Zobrist::pieceHi[ 2 ][ ptMax ][ 64 ]", &Zobrist::pieceHi[0][0][0], 2, ptMax, 64 );
+	w.table( "const Signature Zobrist::castHi[ 2 ][ 0x88+1 ]", &Zobrist::castHi[0][0], 2, 0x88+1 );
+}
+
+int main( int argc, char **argv )
+{
+	ChessInit init;
+
+	const char *fname = argc > 1 ? argv[1] : "gentables.cpp";
+	FILE *f = fopen( fname, "w" );
+	if ( !f )
+	{
+		fprintf( stderr, "cannot create %s\n", fname );
+		return 1;
+	}
+
+	TableWriter w( f );
+	w.raw(
+		"// generated by livius-gentables - do not edit (regenerate with make gentables)\n\n"
+		"#include \"tables.h\"\n"
+		"#include \"magic.h\"\n"
+		"#include \"zobrist.h\"\n\n"
+		"#if defined(LIVIUS_GENTABLES)\n\n"
+		"namespace cheng4\n"
+		"{\n\n"
+	);
+	TablesDump::write( w );
+	MagicDump::write( w );
+	writeZobrist( w );
+	w.raw(
+		"}\n\n"
+		"#endif\n"
+	);
+
+	bool ok = !ferror( f );
+	ok &= fclose( f ) == 0;
+	if ( !ok )
+	{
+		fprintf( stderr, "error writing %s\n", fname );
+		remove( fname );
+		return 1;
+	}
+	printf( "%s: %u KB of tables\n", fname, (uint)((w.bytes + 1023) / 1024) );
+	return 0;
+}
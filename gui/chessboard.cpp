@@ -29,7 +29,7 @@ freely, subject to the following restrictions:
 #include <QSvgRenderer>
 
 ChessBoard::ChessBoard(QWidget *parent) :
-	QWidget(parent), pieceSet(0)
+	QWidget(parent), pieceSet(0), source(0)
 {
 	init();
 	setMinimumWidth( 128 );
@@ -136,7 +136,9 @@ void ChessBoard::setFEN(const QString &fen)
 // get FEN
 QString ChessBoard::getFEN() const
 {
-	return QString(board.toFEN().c_str());
+	char fen[256];
+	*board.toFEN( fen ) = 0;
+	return QString::fromLatin1( fen );
 }
 
 // get turn (stm)
@@ -331,8 +333,19 @@ void ChessBoard::renderBoard( QPainter &p, const QRectF &rc, bool flip,
 		p.drawRect( lwr );
 }
 
+// set board source (0 = none)
+void ChessBoard::setSource( Source *src )
+{
+	source = src;
+	update();
+}
+
 void ChessBoard::paintEvent(QPaintEvent * /*e*/)
 {
+	cheng4::Move move = highlight;
+	if ( source && source->getBoard( board, move ) )
+		highlight = move;
+
 	QImage img( size, QImage::Format_RGB32 );
 	QPainter p( &img );
 	p.setRenderHint(QPainter::Antialiasing, 1);
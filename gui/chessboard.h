@@ -51,6 +51,15 @@ class ChessBoard : public QWidget
 		const std::vector<cheng4::Square> *excludeSquares = 0 );
 
 public:
+	// board source, pulled at paint time
+	class Source
+	{
+	public:
+		virtual ~Source() {}
+		// get board and highlight to show, return 0 (leaving b untouched) to keep current board
+		virtual bool getBoard( cheng4::Board &b, cheng4::Move &move ) = 0;
+	};
+
 	explicit ChessBoard(QWidget *parent = 0);
 
 	// set board
@@ -78,6 +87,9 @@ public:
 
 	void setPieceSet( PieceSet *pset );
 
+	// set board source (0 = none)
+	void setSource( Source *src );
+
 	// set border flag
 	void setBorder( bool flag );
 	// has border?
@@ -110,6 +122,7 @@ public slots:
 private:
 	QSize size;
 	PieceSet *pieceSet;
+	Source *source;
 	bool border;
 	bool flipped;
 	cheng4::Move highlight;
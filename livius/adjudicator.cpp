@@ -0,0 +1,136 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "adjudicator.h"
+#include <string.h>
+
+// Adjudicator
+
+Adjudicator::Adjudicator() : status( asNone ), repetitions(0)
+{
+	memset( table, 0, sizeof(table) );
+	used.reserve( TABLE_SIZE/2 );
+	board.reset();
+	reset( board );
+}
+
+// reset to new starting position
+void Adjudicator::reset( const cheng4::Board &start )
+{
+	board = start;
+	clearHistory();
+	repetitions = addPosition( board.sig() );
+	status = evaluate();
+}
+
+// play move (must be legal) and return new status
+Adjudicator::Status Adjudicator::push( cheng4::Move move )
+{
+	bool irreversible = board.isIrreversible( move );
+	cheng4::UndoInfo ui;
+	board.doMove( move, ui, board.isCheck( move, board.discovered() ) );
+	// positions before an irreversible move can't repeat anymore
+	if ( irreversible )
+		clearHistory();
+	repetitions = addPosition( board.sig() );
+	status = evaluate();
+	return status;
+}
+
+Adjudicator::Status Adjudicator::getStatus() const
+{
+	return status;
+}
+
+// number of times current position occurred since last irreversible move
+uint Adjudicator::getRepetitions() const
+{
+	return repetitions;
+}
+
+// human readable status text (empty for asNone)
+const char *Adjudicator::getStatusText( Status status )
+{
+	switch( status )
+	{
+	case asCheckmate:
+		return "checkmate";
+	case asStalemate:
+		return "stalemate";
+	case asRepetition:
+		return "draw claimable (threefold repetition)";
+	case asFifty:
+		return "draw claimable (fifty move rule)";
+	case asMaterial:
+		return "draw (insufficient material)";
+	default:
+		return "";
+	}
+}
+
+// clear repetition history
+void Adjudicator::clearHistory()
+{
+	for ( size_t i=0; i<used.size(); i++ )
+		table[ used[i] ].count = 0;
+	used.clear();
+}
+
+// add position, returns number of occurrences
+uint Adjudicator::addPosition( cheng4::Signature sig )
+{
+	if ( used.size() >= TABLE_SIZE/2 )
+		// can't happen in a sane game (75 move rule), start over to keep probing short
+		clearHistory();
+	uint idx = (uint)sig & (TABLE_SIZE-1);
+	while ( table[ idx ].count && table[ idx ].sig != sig )
+		idx = (idx + 1) & (TABLE_SIZE-1);
+	Entry &e = table[ idx ];
+	if ( !e.count )
+	{
+		e.sig = sig;
+		used.push_back( idx );
+	}
+	return ++e.count;
+}
+
+Adjudicator::Status Adjudicator::evaluate() const
+{
+	// early exit on first legal move
+	cheng4::MoveGen mg( board );
+	if ( mg.next() == cheng4::mcNone )
+		return board.inCheck() ? asCheckmate : asStalemate;
+	if ( repetitions >= 3 )
+		return asRepetition;
+	switch( board.isDraw() )
+	{
+	case cheng4::drawFifty:
+		return asFifty;
+	case cheng4::drawMaterial:
+		return asMaterial;
+	default:
+		return asNone;
+	}
+}
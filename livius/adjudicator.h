@@ -0,0 +1,90 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef ADJUDICATOR_H
+#define ADJUDICATOR_H
+
+#include <vector>
+#include "chess/chess.h"
+
+// live game adjudication tracker
+// detects mate, stalemate, threefold repetition, fifty move rule and material draws
+// as moves arrive, so that viewers see the outcome before the server announces the result
+class Adjudicator
+{
+public:
+	enum Status
+	{
+		asNone,			// game goes on
+		asCheckmate,	// side to move is mated
+		asStalemate,	// side to move has no legal moves
+		asRepetition,	// threefold repetition (draw claimable)
+		asFifty,		// fifty move rule (draw claimable)
+		asMaterial		// insufficient material
+	};
+
+	Adjudicator();
+
+	// reset to new starting position
+	void reset( const cheng4::Board &start );
+	// play move (must be legal) and return new status
+	Status push( cheng4::Move move );
+
+	Status getStatus() const;
+	// number of times current position occurred since last irreversible move
+	uint getRepetitions() const;
+
+	// human readable status text (empty for asNone)
+	static const char *getStatusText( Status status );
+
+private:
+	enum
+	{
+		// must be power of two, bigger than twice the number of plies we can track
+		TABLE_SIZE = 1024
+	};
+
+	struct Entry
+	{
+		cheng4::Signature sig;
+		uint count;
+	};
+
+	cheng4::Board board;
+	Status status;
+	uint repetitions;
+	// open addressing hash table of positions since last irreversible move
+	Entry table[ TABLE_SIZE ];
+	// used slots (so that clearing costs as much as number of positions stored)
+	std::vector< uint > used;
+
+	// clear repetition history
+	void clearHistory();
+	// add position, returns number of occurrences
+	uint addPosition( cheng4::Signature sig );
+	Status evaluate() const;
+};
+
+#endif // ADJUDICATOR_H
@@ -30,7 +30,10 @@ freely, subject to the following restrictions:
 
 ChatInfo::ChatInfo(QWidget *parent) :
 	QWidget(parent),
-	ui(new Ui::ChatInfo)
+	ui(new Ui::ChatInfo),
+	state(0),
+	usersVersion(0),
+	hasUsers(0)
 {
 	ui->setupUi(this);
 	new ChatHighlighter( ui->chatEdit->document() );
@@ -72,10 +75,26 @@ bool ChatInfo::getPVTip() const
 	return ui->pvTipCheck->isChecked();
 }
 
-void ChatInfo::setUsers( const QStringList &ul )
+// set state to pull users from
+void ChatInfo::setState( const LiveGameState *st )
 {
+	state = st;
+	hasUsers = 0;
+	sync();
+}
+
+// pull users from latest state snapshot if they changed
+void ChatInfo::sync()
+{
+	if ( !state )
+		return;
+	LiveGameState::SnapshotPtr snap = state->getSnapshot();
+	if ( hasUsers && usersVersion == snap->usersVersion )
+		return;
+	hasUsers = 1;
+	usersVersion = snap->usersVersion;
 	ui->userList->clear();
-	ui->userList->addItems( ul );
+	ui->userList->addItems( snap->users );
 }
 
 // set nick
@@ -102,3 +121,13 @@ void ChatInfo::on_reconnectButton_clicked()
 {
 	sigReconnect();
 }
+
+void ChatInfo::on_pvCheck_toggled( bool checked )
+{
+	sigPVOptionsChanged( checked, getPVTip() );
+}
+
+void ChatInfo::on_pvTipCheck_toggled( bool checked )
+{
+	sigPVOptionsChanged( getPrettyPV(), checked );
+}
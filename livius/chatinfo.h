@@ -28,6 +28,7 @@ freely, subject to the following restrictions:
 
 #include <QWidget>
 #include "sig/signal.h"
+#include "livegamestate.h"
 
 namespace Ui {
 class ChatInfo;
@@ -47,8 +48,8 @@ public:
 	void addMsg( const QString &msg );
 	// add error message
 	void addErr( const QString &msg );
-	// set users list
-	void setUsers( const QStringList &ul );
+	// set state to pull users from
+	void setState( const LiveGameState *st );
 	// set nick
 	void setNick( const QString &newNick );
 	// pretty PV checked?
@@ -59,6 +60,11 @@ public:
 	sig::Signal< void, const QString & > sigSendMessage;
 	sig::Signal< void, const QString & > sigChangeNick;
 	sig::Signal< void > sigReconnect;
+	// pretty PV, PV tip
+	sig::Signal< void, bool, bool > sigPVOptionsChanged;
+
+	// pull users from latest state snapshot if they changed
+	void sync();
 
 private slots:
 	void on_messageEdit_returnPressed();
@@ -67,8 +73,17 @@ private slots:
 
 	void on_reconnectButton_clicked();
 
+	void on_pvCheck_toggled( bool checked );
+
+	void on_pvTipCheck_toggled( bool checked );
+
 private:
 	Ui::ChatInfo *ui;
+	// state to pull from (not owned)
+	const LiveGameState *state;
+	// users version shown
+	quint64 usersVersion;
+	bool hasUsers;
 };
 
 #endif // CHATINFO_H
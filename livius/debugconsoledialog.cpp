@@ -25,55 +25,38 @@ freely, subject to the following restrictions:
 
 #include "debugconsoledialog.h"
 #include "ui_debugconsoledialog.h"
-#include "tlcvclient.h"
+#include "liveingest.h"
 #include <QTime>
 
 DebugConsoleDialog::DebugConsoleDialog(QWidget *parent) :
 	QDialog(parent),
 	ui(new Ui::DebugConsoleDialog),
-	clientRef(0)
+	ingestRef(0)
 {
 	ui->setupUi(this);
-	connect(this, SIGNAL(send(const QString &, bool)),
-			this, SLOT(onGuiSend(const QString &, bool)));
-	connect(this, SIGNAL(receive(const QByteArray &)),
-			this, SLOT(onGuiReceive(const QByteArray &)));
-	connect(this, SIGNAL(queue(size_t)),
-			this, SLOT(onGuiQueue(size_t)));
 }
 
 DebugConsoleDialog::~DebugConsoleDialog()
 {
-	setClient(0);
+	setIngest(0);
 	delete ui;
 }
 
-void DebugConsoleDialog::setClient( TLCVClient *client )
+void DebugConsoleDialog::setIngest( LiveIngest *ingest )
 {
-	conn[0].disconnect();
-	conn[1].disconnect();
-	conn[2].disconnect();
-	clientRef = client;
-	if ( !client )
+	if ( ingestRef )
+		ingestRef->disconnect( this );
+	ingestRef = ingest;
+	if ( !ingest )
 		return;
-	conn[0] = client->sigDebugSend.connect( this, &DebugConsoleDialog::onSend );
-	conn[1] = client->sigDebugReceive.connect( this, &DebugConsoleDialog::onReceive );
-	conn[2] = client->sigDebugQueue.connect( this, &DebugConsoleDialog::onQueue );
-}
-
-void DebugConsoleDialog::onSend( const QString &msg, bool ok )
-{
-	emit send( msg, ok );
-}
-
-void DebugConsoleDialog::onReceive( const QByteArray &msg )
-{
-	emit receive( msg );
-}
-
-void DebugConsoleDialog::onQueue( size_t size )
-{
-	emit queue( size );
+	connect(ingest, SIGNAL(debugSend(QString, bool)),
+			this, SLOT(onGuiSend(QString, bool)));
+	connect(ingest, SIGNAL(debugReceive(QByteArray)),
+			this, SLOT(onGuiReceive(QByteArray)));
+	connect(ingest, SIGNAL(debugQueue(int, quint64)),
+			this, SLOT(onGuiQueue(int, quint64)));
+	connect(ingest, SIGNAL(debugSequencer(quint64, quint64, quint64, quint64, int)),
+			this, SLOT(onGuiSequencer(quint64, quint64, quint64, quint64, int)));
 }
 
 static QString curTime()
@@ -109,17 +92,27 @@ void DebugConsoleDialog::onGuiReceive( const QByteArray &msg )
 	ui->debugEdit->append( txt );
 }
 
-void DebugConsoleDialog::onGuiQueue( size_t size )
+void DebugConsoleDialog::onGuiQueue( int size, quint64 shed )
 {
 	QString str;
-	str.sprintf("Queue: %d", (int)size);
+	str.sprintf("Queue: %d Shed: %llu", size, (unsigned long long)shed);
 	ui->queueLabel->setText( str );
 }
 
+void DebugConsoleDialog::onGuiSequencer( quint64 applied, quint64 stale, quint64 resyncs, quint64 gaps, int pending )
+{
+	QString str;
+	str.sprintf("Moves: %llu Stale: %llu Resyncs: %llu Gaps: %llu Pending: %d",
+		(unsigned long long)applied, (unsigned long long)stale,
+		(unsigned long long)resyncs, (unsigned long long)gaps, pending);
+	ui->sequencerLabel->setText( str );
+}
+
 void DebugConsoleDialog::on_commandEdit_returnPressed()
 {
-	if ( !clientRef )
+	if ( !ingestRef )
 		return;
-	clientRef->send( ui->commandEdit->text() );
+	QMetaObject::invokeMethod( ingestRef, "send", Qt::QueuedConnection,
+		Q_ARG(QString, ui->commandEdit->text()) );
 	ui->commandEdit->clear();
 }
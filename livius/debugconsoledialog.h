@@ -27,13 +27,12 @@ freely, subject to the following restrictions:
 #define DEBUGCONSOLEDIALOG_H
 
 #include <QDialog>
-#include "sig/signal.h"
 
 namespace Ui {
 class DebugConsoleDialog;
 }
 
-class TLCVClient;
+class LiveIngest;
 
 class DebugConsoleDialog : public QDialog
 {
@@ -43,28 +42,20 @@ public:
 	explicit DebugConsoleDialog(QWidget *parent = 0);
 	~DebugConsoleDialog();
 
-	void setClient( TLCVClient *client );
-
-signals:
-	void send( const QString &msg, bool ok );
-	void receive( const QByteArray &msg );
-	void queue( size_t size );
+	// client runs in ingest thread => debug info arrives through queued signals
+	void setIngest( LiveIngest *ingest );
 
 private slots:
 	void onGuiSend( const QString &msg, bool ok );
 	void onGuiReceive( const QByteArray &msg );
-	void onGuiQueue( size_t size );
+	void onGuiQueue( int size, quint64 shed );
+	void onGuiSequencer( quint64 applied, quint64 stale, quint64 resyncs, quint64 gaps, int pending );
 
 	void on_commandEdit_returnPressed();
 
 private:
-
-	void onSend( const QString &msg, bool ok );
-	void onReceive( const QByteArray &msg );
-	void onQueue( size_t size );
 	Ui::DebugConsoleDialog *ui;
-	TLCVClient *clientRef;
-	sig::Connection conn[3];
+	LiveIngest *ingestRef;
 };
 
 #endif // DEBUGCONSOLEDIALOG_H
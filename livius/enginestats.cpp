@@ -0,0 +1,378 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "enginestats.h"
+#include "config/config.h"
+#include <QDateTime>
+#include <string.h>
+
+static bool statsEnabled = 0;
+static QString statsFile = "enginestats.bin";
+
+// flush at least this often (ms)
+static const int flushInterval = 1000;
+// wake up writer early if we have more pending data than this
+static const size_t flushThreshold = 65536;
+
+static const char statsMagic[4] = { 'L', 'V', 'E', 'S' };
+
+// EngineStatsLog::Writer
+
+class EngineStatsLog::Writer : public core::Thread
+{
+	volatile bool done;
+public:
+	EngineStatsLog *log;
+
+	Writer() : done(0), log(0) {}
+
+	void destroy()
+	{
+		done = 1;
+		log->event.signal();
+	}
+
+	void work()
+	{
+		std::vector< core::u8 > tmp;
+		while ( !done )
+		{
+			log->event.wait( flushInterval );
+			log->flush( tmp );
+		}
+		log->flush( tmp );
+	}
+};
+
+// EngineStatsLog
+
+EngineStatsLog::EngineStatsLog() : writer(0), file(0)
+{
+}
+
+EngineStatsLog::~EngineStatsLog()
+{
+	close();
+}
+
+bool EngineStatsLog::open( const QString &fnm )
+{
+	close();
+	file = fopen( fnm.toLocal8Bit().constData(), "ab" );
+	if ( !file )
+		return 0;
+	fseek( file, 0, SEEK_END );
+	bool empty = ftell( file ) <= 0;
+
+	{
+		core::MutexLock lock( mutex );
+		buffer.clear();
+		names.clear();
+		if ( empty )
+		{
+			for ( int i=0; i<4; i++ )
+				put8( (core::u8)statsMagic[i] );
+			put16( VERSION );
+			put16( 0 );
+		}
+		// new session
+		put8( 'B' );
+		put64( (core::u64)QDateTime::currentMSecsSinceEpoch() );
+	}
+
+	writer = new Writer;
+	writer->log = this;
+	if ( !writer->run() )
+	{
+		writer->kill();
+		writer = 0;
+		fclose( file );
+		file = 0;
+		return 0;
+	}
+	return 1;
+}
+
+void EngineStatsLog::close()
+{
+	if ( writer )
+	{
+		// also does final flush
+		writer->kill();
+		writer = 0;
+	}
+	if ( file )
+	{
+		fclose( file );
+		file = 0;
+	}
+}
+
+bool EngineStatsLog::isOpen() const
+{
+	return file != 0;
+}
+
+void EngineStatsLog::put8( core::u8 v )
+{
+	buffer.push_back( v );
+}
+
+void EngineStatsLog::put16( core::u16 v )
+{
+	put8( (core::u8)v );
+	put8( (core::u8)(v >> 8) );
+}
+
+void EngineStatsLog::put32( core::u32 v )
+{
+	put16( (core::u16)v );
+	put16( (core::u16)(v >> 16) );
+}
+
+void EngineStatsLog::put64( core::u64 v )
+{
+	put32( (core::u32)v );
+	put32( (core::u32)(v >> 32) );
+}
+
+// note: mutex must be locked
+core::u16 EngineStatsLog::getNameId( const QString &name )
+{
+	std::map< QString, core::u16 >::const_iterator ci = names.find( name );
+	if ( ci != names.end() )
+		return ci->second;
+	core::u16 id = (core::u16)names.size();
+	names[ name ] = id;
+	QByteArray utf = name.toUtf8();
+	size_t len = utf.size();
+	if ( len > 65535 )
+		len = 65535;
+	put8( 'N' );
+	put16( id );
+	put16( (core::u16)len );
+	buffer.insert( buffer.end(), (const core::u8 *)utf.constData(), (const core::u8 *)utf.constData() + len );
+	return id;
+}
+
+void EngineStatsLog::addPV( const QString &player, int color, int depth, int score, int timehs, core::i64 nodes )
+{
+	core::MutexLock lock( mutex );
+	if ( !file )
+		return;
+	core::u16 id = getNameId( player );
+	put8( 'P' );
+	put64( (core::u64)QDateTime::currentMSecsSinceEpoch() );
+	put16( id );
+	put8( (core::u8)color );
+	put8( (core::u8)(depth < 0 ? 0 : depth > 255 ? 255 : depth) );
+	put32( (core::u32)score );
+	put32( (core::u32)timehs );
+	put64( (core::u64)nodes );
+	if ( buffer.size() >= flushThreshold )
+		event.signal();
+}
+
+void EngineStatsLog::flush( std::vector< core::u8 > &tmp )
+{
+	{
+		core::MutexLock lock( mutex );
+		// note: swapping keeps capacity so we don't reallocate in steady state
+		tmp.swap( buffer );
+	}
+	if ( tmp.empty() )
+		return;
+	fwrite( &tmp[0], 1, tmp.size(), file );
+	fflush( file );
+	tmp.clear();
+}
+
+// log reader helper
+struct StatsReader
+{
+	const core::u8 *ptr, *top;
+
+	StatsReader( const std::vector< core::u8 > &data ) : ptr(0), top(0)
+	{
+		if ( data.empty() )
+			return;
+		ptr = &data[0];
+		top = ptr + data.size();
+	}
+
+	bool has( size_t n ) const
+	{
+		return (size_t)(top - ptr) >= n;
+	}
+
+	core::u8 get8()
+	{
+		return *ptr++;
+	}
+
+	core::u16 get16()
+	{
+		core::u16 res = get8();
+		return res | ((core::u16)get8() << 8);
+	}
+
+	core::u32 get32()
+	{
+		core::u32 res = get16();
+		return res | ((core::u32)get16() << 16);
+	}
+
+	core::u64 get64()
+	{
+		core::u64 res = get32();
+		return res | ((core::u64)get32() << 32);
+	}
+};
+
+static QString csvEscape( const QString &str )
+{
+	QString res = str;
+	res.replace( "\"", "\"\"" );
+	return '"' + res + '"';
+}
+
+// convert binary log to CSV
+bool EngineStatsLog::exportCSV( const QString &logName, const QString &csvName, QString *error )
+{
+	FILE *f = fopen( logName.toLocal8Bit().constData(), "rb" );
+	if ( !f )
+	{
+		if ( error )
+			*error = "cannot open " + logName;
+		return 0;
+	}
+	std::vector< core::u8 > data;
+	core::u8 buf[16384];
+	size_t nr;
+	while ( (nr = fread( buf, 1, sizeof(buf), f )) > 0 )
+		data.insert( data.end(), buf, buf + nr );
+	fclose( f );
+
+	StatsReader r( data );
+	if ( !r.has(8) || memcmp( r.ptr, statsMagic, 4 ) != 0 )
+	{
+		if ( error )
+			*error = "not an engine stats log";
+		return 0;
+	}
+	r.ptr += 4;
+	if ( r.get16() != VERSION )
+	{
+		if ( error )
+			*error = "unsupported engine stats log version";
+		return 0;
+	}
+	r.get16();
+
+	FILE *out = fopen( csvName.toLocal8Bit().constData(), "wb" );
+	if ( !out )
+	{
+		if ( error )
+			*error = "cannot create " + csvName;
+		return 0;
+	}
+
+	fputs( "timestamp,session,player,color,depth,score,time_ms,nodes,nps\n", out );
+
+	std::vector< QByteArray > nameTable;
+	int session = 0;
+	bool res = 1;
+	while ( r.has(1) )
+	{
+		core::u8 tag = r.get8();
+		if ( tag == 'B' && r.has(8) )
+		{
+			r.get64();
+			nameTable.clear();
+			session++;
+		}
+		else if ( tag == 'N' && r.has(4) )
+		{
+			core::u16 id = r.get16();
+			core::u16 len = r.get16();
+			if ( !r.has(len) )
+			{
+				res = 0;
+				break;
+			}
+			if ( id >= nameTable.size() )
+				nameTable.resize( id+1 );
+			QString name = QString::fromUtf8( (const char *)r.ptr, len );
+			nameTable[id] = csvEscape( name ).toUtf8();
+			r.ptr += len;
+		}
+		else if ( tag == 'P' && r.has(28) )
+		{
+			core::i64 timestamp = (core::i64)r.get64();
+			core::u16 id = r.get16();
+			int color = r.get8();
+			int depth = r.get8();
+			int score = (core::i32)r.get32();
+			int timehs = (core::i32)r.get32();
+			core::i64 nodes = (core::i64)r.get64();
+			core::i64 nps = timehs > 0 ? nodes * 100 / timehs : 0;
+			fprintf( out, "%lld,%d,%s,%c,%d,%d,%d,%lld,%lld\n", (long long)timestamp, session,
+				id < nameTable.size() ? nameTable[id].constData() : "\"?\"",
+				color ? 'b' : 'w', depth, score, timehs*10, (long long)nodes, (long long)nps );
+		}
+		else
+		{
+			// unknown tag or truncated record
+			res = 0;
+			break;
+		}
+	}
+	fclose( out );
+	if ( !res && error )
+		*error = "corrupted engine stats log";
+	return res;
+}
+
+// enabled in config?
+bool EngineStatsLog::isEnabled()
+{
+	return statsEnabled;
+}
+
+// log filename from config
+QString EngineStatsLog::getFileName()
+{
+	return statsFile;
+}
+
+bool EngineStatsLog::addConfig( config::ConfigVarBase *parent )
+{
+	if ( !parent )
+		return 0;
+	config::CVarGroup *group = new config::CVarGroup("Engine Stats");
+	group->addChild( new config::CVarBool("Enabled", &statsEnabled, config::CF_EDIT) );
+	group->addChild( new config::CVarQString("File", &statsFile, config::CF_EDIT) );
+	return parent->addChild( group );
+}
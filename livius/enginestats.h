@@ -0,0 +1,105 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef ENGINESTATS_H
+#define ENGINESTATS_H
+
+#include <QString>
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include "core/types.h"
+#include "core/thread.h"
+
+namespace config
+{
+class ConfigVarBase;
+}
+
+// engine statistics log
+// collects parsed PV info (depth, score, time, nodes) and appends it to a compact binary file
+// capture only appends to a memory buffer, file I/O is done by a background writer thread
+//
+// file format (little endian):
+// header: "LVES", u16 version, u16 reserved
+// followed by a stream of tagged records:
+// 'B' session start: i64 timestamp (ms since epoch), resets name table
+// 'N' name: u16 id, u16 length, UTF-8 bytes
+// 'P' PV sample: i64 timestamp, u16 name id, u8 color, u8 depth, i32 score, i32 time (1/100 s), i64 nodes
+class EngineStatsLog
+{
+public:
+	enum
+	{
+		VERSION = 1
+	};
+
+	EngineStatsLog();
+	~EngineStatsLog();
+
+	// open log for appending and start writer thread
+	bool open( const QString &fnm );
+	// flush pending data and close log
+	void close();
+	bool isOpen() const;
+
+	// add PV sample
+	void addPV( const QString &player, int color, int depth, int score, int timehs, core::i64 nodes );
+
+	// convert binary log to CSV
+	// returns 0 on failure, optionally returns error string
+	static bool exportCSV( const QString &logName, const QString &csvName, QString *error = 0 );
+
+	// enabled in config?
+	static bool isEnabled();
+	// log filename from config
+	static QString getFileName();
+
+	// add config vars for engine stats
+	static bool addConfig( config::ConfigVarBase *parent );
+
+private:
+	class Writer;
+	friend class Writer;
+
+	// pending data
+	std::vector< core::u8 > buffer;
+	// name => id map
+	std::map< QString, core::u16 > names;
+	core::Mutex mutex;
+	core::Event event;
+	Writer *writer;
+	FILE *file;
+
+	void put8( core::u8 v );
+	void put16( core::u16 v );
+	void put32( core::u32 v );
+	void put64( core::u64 v );
+	core::u16 getNameId( const QString &name );
+	// write pending data (called from writer thread)
+	void flush( std::vector< core::u8 > &tmp );
+};
+
+#endif // ENGINESTATS_H
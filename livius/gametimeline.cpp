@@ -0,0 +1,109 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "gametimeline.h"
+
+GameTimeline::GameTimeline()
+{
+	cheng4::Board b;
+	b.reset();
+	reset( b );
+}
+
+// reset to new starting position
+void GameTimeline::reset( const cheng4::Board &start )
+{
+	moves.clear();
+	keyframes.clear();
+	startPos = start;
+	addKeyframe( start );
+	tip = start;
+}
+
+void GameTimeline::addKeyframe( const cheng4::Board &b )
+{
+	cheng4::PackedBoard pb;
+	b.pack( pb );
+	keyframes.push_back( pb );
+}
+
+void GameTimeline::doMove( cheng4::Board &b, cheng4::Move move )
+{
+	cheng4::UndoInfo ui;
+	b.doMove( move, ui, b.isCheck( move, b.discovered() ) );
+	if ( b.turn() == cheng4::ctWhite )
+		b.incMove();
+}
+
+// append move (must be legal at tip)
+void GameTimeline::append( cheng4::Move move )
+{
+	doMove( tip, move );
+	moves.push_back( move );
+	if ( moves.size() % KEYFRAME_INTERVAL == 0 )
+		addKeyframe( tip );
+}
+
+// number of plies
+size_t GameTimeline::size() const
+{
+	return moves.size();
+}
+
+// get move at ply index
+cheng4::Move GameTimeline::getMove( size_t index ) const
+{
+	return index < moves.size() ? moves[index] : cheng4::mcNone;
+}
+
+// starting position
+const cheng4::Board &GameTimeline::getStart() const
+{
+	return startPos;
+}
+
+// current (last) position
+const cheng4::Board &GameTimeline::getTip() const
+{
+	return tip;
+}
+
+// get board after ply moves (0 = starting position)
+cheng4::Board GameTimeline::boardAt( size_t ply ) const
+{
+	if ( ply >= moves.size() )
+		return tip;
+	size_t key = ply / KEYFRAME_INTERVAL;
+	cheng4::Board b;
+	// unpack only fails for (edited) positions with more than 32 pieces => replay from start
+	if ( !key || !b.unpack( keyframes[ key ] ) )
+	{
+		b = startPos;
+		key = 0;
+	}
+	for ( size_t i = key * KEYFRAME_INTERVAL; i < ply; i++ )
+		doMove( b, moves[i] );
+	return b;
+}
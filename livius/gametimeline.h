@@ -0,0 +1,74 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef GAMETIMELINE_H
+#define GAMETIMELINE_H
+
+#include <vector>
+#include "chess/chess.h"
+
+// navigable game history
+// stores a packed keyframe board every KEYFRAME_INTERVAL plies so that any position
+// can be rebuilt by replaying at most KEYFRAME_INTERVAL-1 moves
+class GameTimeline
+{
+public:
+	enum
+	{
+		KEYFRAME_INTERVAL = 16
+	};
+
+	GameTimeline();
+
+	// reset to new starting position
+	void reset( const cheng4::Board &start );
+	// append move (must be legal at tip)
+	void append( cheng4::Move move );
+
+	// number of plies
+	size_t size() const;
+	// get move at ply index
+	cheng4::Move getMove( size_t index ) const;
+
+	// starting position
+	const cheng4::Board &getStart() const;
+	// current (last) position
+	const cheng4::Board &getTip() const;
+
+	// get board after ply moves (0 = starting position)
+	cheng4::Board boardAt( size_t ply ) const;
+
+private:
+	std::vector< cheng4::Move > moves;
+	// keyframes[i] = board after i*KEYFRAME_INTERVAL plies
+	std::vector< cheng4::PackedBoard > keyframes;
+	cheng4::Board startPos;
+	cheng4::Board tip;
+
+	static void doMove( cheng4::Board &b, cheng4::Move move );
+	void addKeyframe( const cheng4::Board &b );
+};
+
+#endif // GAMETIMELINE_H
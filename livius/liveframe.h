@@ -34,6 +34,9 @@ freely, subject to the following restrictions:
 #include "chess/chess.h"
 #include "config/config.h"
 #include "ack.h"
+#include "livegamestate.h"
+#include "gametimeline.h"
+#include "chessboard.h"
 
 namespace config
 {
@@ -44,23 +47,21 @@ class LiveInfo;
 class ChatInfo;
 class QSplitter;
 class QTimer;
-class ChessBoard;
+class QListView;
+class QModelIndex;
+class MoveListModel;
 class PieceSet;
-class TLCVClient;
+class LiveIngest;
+class EngineStatsLog;
 
-class LiveFrame : public QWidget
+class LiveFrame : public QWidget, public ChessBoard::Source
 {
 	Q_OBJECT
 public:
 	typedef QWidget super;
 
-	struct MenuItem
-	{
-		int id, width, height;
-		QString name, url;
-	};
-
-	typedef std::map< int, MenuItem > MenuMap;
+	typedef LiveGameState::MenuItem MenuItem;
+	typedef LiveGameState::MenuMap MenuMap;
 
 	explicit LiveFrame(QWidget *parent = 0, PieceSet *pset = 0,
 		const QString &nick = "Anonymous", const QString &url = QString(), quint16 port = 0,
@@ -98,27 +99,45 @@ public:
 	const MenuMap &getMenu() const;
 	// get PGN
 	QString getPGN() const;
-	// get client
-	TLCVClient *getClient() const;
+	// get ingest
+	LiveIngest *getIngest() const;
 	// add config vars for ChessBoard
 	static bool addConfig( config::ConfigVarBase *parent );
 	void updateConfig();
+	// set engine stats log (may be 0)
+	void setStatsLog( EngineStatsLog *log );
 
 signals:
 
+	// board source for live view
+	bool getBoard( cheng4::Board &b, cheng4::Move &move );
+
 private slots:
 	void onTimer();
+	// game state changed (sent by ingest)
+	void onStateChanged();
+	void onMessage( int type, const QString &txt );
+	void onSiteChanged( const QString &site );
+	void onCrossTableClear();
+	void onCrossTableAdd( const QString &str );
+	void onGameListAdd( const QString &str );
+	void onPGNChanged( const QString &pgn );
+	// move list selection changed (invalid = back to live)
+	void onMoveSelected( const QModelIndex &current );
 
 private:
 	QSplitter *splitter;
 	QSplitter *hsplitter;
+	// info + move list
+	QSplitter *infoSplitter;
+	QListView *moveList;
+	MoveListModel *moveModel;
 	ChessBoard *board;
 	LiveInfo *info;
 	ChatInfo *chat;
-	TLCVClient *client;
+	// runs the client in a separate thread
+	LiveIngest *ingest;
 	QTimer *timer;
-	// game running?
-	bool running;
 	int layoutType;
 
 	// current crosstable
@@ -126,64 +145,22 @@ private:
 	// current gamelist
 	QStringList gameList;
 
-	struct MoveInfo
-	{
-		int color;
-		QString str;	// move text
-	};
-
-	std::map< AckType, MoveInfo > bufferedMoves;
-
-	std::set< QString > userSet;
-	MenuMap menu;
-
-	struct CurrentGame
-	{
-		// a copy of current site name
-		QString site;
-		// current game pgn date
-		QString date;
-		// white player
-		QString white;
-		// black player
-		QString black;
-		// time control (m/)bs(+is)
-		QString timeControl;
-		// result
-		QString result;
-		// current game starting position
-		cheng4::Board board;
-		// list of current game moves
-		std::vector< cheng4::Move > moves;
-
-		// clear
-		void clear( bool full = 0 );
-	};
-
-	// recorded (actual) pgn data of finished games
-	QString pgn;
-	// pgn data (current game)
-	CurrentGame current;
-
-	// get current pgn as text
-	QString getCurrent() const;
-	// add current pgn to pgn text
-	void addCurrent( bool fullReset = 0 );
+	// game state (model)
+	LiveGameState state;
+	// latest snapshot seen (timeline, menu)
+	LiveGameState::SnapshotPtr shown;
+	// navigable history of current game
+	GameTimeline timeline;
+	// ply shown on board (-1 = live)
+	int viewPly;
+
+	// append new moves from snapshot to timeline and move list
+	void updateTimeline( const LiveGameState::CurrentGame &game );
+
 	void reconnect();
-	void updateUsers();
-	bool parseMenu( const char * c );
-	void parsePV( int color, const char *c );
-	void parseTime( int color, const char *c );
-	void parseLevel( const char *c );
-	bool parseMove( int color, AckType ack, const char *c, bool nobuffer = 0 );
-	void parseCommand( int cmd, AckType ack, const char *c );
-	void connectionError( int err );
 	void connectSignals( bool disconn = 0 );
 	void sendMessage( const QString &msg );
 	void changeNick( const QString &newNick );
-	void setRunning( bool flag );
-	// clears buffered moves with older acks (we got a valid move)
-	void clearBufferedMoves( AckType ack );
 };
 
 #endif // LIVEFRAME_H
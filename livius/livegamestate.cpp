@@ -0,0 +1,589 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "livegamestate.h"
+#include "config/config.h"
+#include "tlcvclient.h"
+#include <QDate>
+#include <string.h>
+
+static const char startFEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// LiveGameState::CurrentGame
+
+void LiveGameState::CurrentGame::clear( bool full )
+{
+	if ( full )
+	{
+		white.clear();
+		black.clear();
+		timeControl.clear();
+		date.clear();
+	}
+	result.clear();
+	board.reset();
+	moves.clear();
+}
+
+static QString stripResult( const QString &res )
+{
+	if ( res.startsWith("1-0") )
+		return "1-0";
+	if ( res.startsWith("0") )
+		return "0-1";
+	if ( res.startsWith("1/2") )
+		return "1/2-1/2";
+	return "*";
+}
+
+// get pgn as text
+QString LiveGameState::CurrentGame::toPGN( cheng4::FENCache &fens ) const
+{
+	if ( moves.empty() )
+		return QString();
+	// build tags...
+	QString res;
+	res += "[Event \"Computer game\"]\n";
+
+	res += "[Site \"";
+	res += site.isEmpty() ? "?" : config::escape(site);
+	res += "\"]\n";
+
+	res += "[Date \"";
+	res += date.isEmpty() ? "????.??.??" : config::escape(date);
+	res += "\"]\n";
+
+	res += "[Round \"?\"]\n";
+
+	res += "[White \"";
+	res += white.isEmpty() ? "?" : config::escape(white);
+	res += "\"]\n";
+
+	res += "[Black \"";
+	res += black.isEmpty() ? "?" : config::escape(black);
+	res += "\"]\n";
+
+	res += "[TimeControl \"";
+	res += timeControl.isEmpty() ? "?" : config::escape(timeControl);
+	res += "\"]\n";
+
+	const char *fen = fens.get( board );
+	if ( strcmp( fen, startFEN ) != 0 )
+	{
+		res += "[SetUp \"1\"]\n";
+		res += "[FEN \"";
+		res += QLatin1String( fen );
+		res += "\"]\n";
+	}
+
+	res += "[Result \"";
+	res += result.isEmpty() ? "*" : config::escape(stripResult(result));
+	res += "\"]\n\n";
+
+	cheng4::Board tb( board );
+	// now add moves!
+	// current line
+	QString line;
+	for (size_t i=0; i<moves.size(); i++)
+	{
+		QString text;
+		if ( !i || tb.turn() == cheng4::ctWhite )
+		{
+			// move number
+			int move = (int)tb.move();
+			QString tmp;
+			tmp.sprintf("%d.", move);
+			text += tmp;
+			if ( tb.turn() == cheng4::ctBlack )
+				text += "..";
+		}
+
+		char buf[256];
+		*tb.toSAN(buf, moves[i] ) = 0;
+
+		// add SAN string
+		text += buf;
+
+		if ( line.length() + text.length() > 80 )
+		{
+			// break now
+			res += line;
+			res += '\n';
+			line = text;
+		}
+		else
+		{
+			line += text;
+		}
+		line += ' ';
+
+		cheng4::UndoInfo ui;
+		bool isCheck = tb.isCheck( moves[i], tb.discovered() );
+		tb.doMove( moves[i], ui, isCheck );
+		if ( tb.turn() == cheng4::ctWhite )
+			tb.incMove();
+	}
+	res += line;
+	res += result.isEmpty() ? "*" : result;
+	res += '\n';
+
+	return res;
+}
+
+// LiveGameState::EngineInfo
+
+void LiveGameState::EngineInfo::clear()
+{
+	version++;
+	depth = score = 0;
+	nodes = nps = 0;
+	pv.clear();
+}
+
+// LiveGameState
+
+LiveGameState::LiveGameState() : running(0), lastMove(cheng4::mcNone),
+	boardVersion(0), usersVersion(0), menuVersion(0), infoVersion(0), dirty(1)
+{
+	board.reset();
+	current.clear( 1 );
+	for ( cheng4::Color c = cheng4::ctWhite; c <= cheng4::ctBlack; c++ )
+	{
+		info.engine[c].version = 0;
+		info.engine[c].clear();
+		info.engine[c].pvBoard.reset();
+		info.time[c] = 0;
+	}
+	info.clockVersion = 0;
+	info.fen = QString::fromLatin1( fenCache.get( board ) );
+}
+
+// get latest snapshot (publishes a new one if state changed since last call)
+LiveGameState::SnapshotPtr LiveGameState::getSnapshot() const
+{
+	core::MutexLock lock( mutex );
+	if ( dirty )
+	{
+		Snapshot *s = new Snapshot;
+		s->boardVersion = boardVersion;
+		s->usersVersion = usersVersion;
+		s->menuVersion = menuVersion;
+		s->running = running;
+		s->board = board;
+		s->lastMove = lastMove;
+		s->adjudication = adjudicator.getStatus();
+		s->game = current;
+		std::set< QString >::const_iterator ci;
+		for ( ci = userSet.begin(); ci != userSet.end(); ci++ )
+			s->users.append( *ci );
+		s->menu = menu;
+		s->infoVersion = infoVersion;
+		s->info = info;
+		// readers still holding the old snapshot keep it alive
+		snapshot = SnapshotPtr( s );
+		dirty = 0;
+	}
+	return snapshot;
+}
+
+void LiveGameState::touchBoard()
+{
+	boardVersion++;
+	info.fen = QString::fromLatin1( fenCache.get( board ) );
+	touchInfo();
+}
+
+void LiveGameState::touchInfo()
+{
+	infoVersion++;
+	dirty = 1;
+}
+
+bool LiveGameState::isRunning() const
+{
+	core::MutexLock lock( mutex );
+	return running;
+}
+
+void LiveGameState::setRunning( bool flag )
+{
+	core::MutexLock lock( mutex );
+	running = flag;
+	if ( !flag )
+		sequencer.clear();
+	dirty = 1;
+}
+
+void LiveGameState::setSite( const QString &site )
+{
+	core::MutexLock lock( mutex );
+	current.site = site;
+	dirty = 1;
+}
+
+void LiveGameState::setPlayer( int color, const QString &name )
+{
+	core::MutexLock lock( mutex );
+	(color == cheng4::ctWhite ? current.white : current.black) = name;
+	// new engine => reset its stats
+	info.engine[color].clear();
+	touchInfo();
+}
+
+QString LiveGameState::getPlayer( int color ) const
+{
+	core::MutexLock lock( mutex );
+	return color == cheng4::ctWhite ? current.white : current.black;
+}
+
+void LiveGameState::setTimeControl( const QString &tc )
+{
+	core::MutexLock lock( mutex );
+	current.timeControl = tc;
+	dirty = 1;
+}
+
+// set result (finishes game)
+void LiveGameState::setResult( const QString &result )
+{
+	core::MutexLock lock( mutex );
+	current.result = result;
+	running = 0;
+	sequencer.clear();
+	dirty = 1;
+}
+
+void LiveGameState::addUser( const QString &user )
+{
+	core::MutexLock lock( mutex );
+	userSet.insert( user );
+	usersVersion++;
+	dirty = 1;
+}
+
+void LiveGameState::removeUser( const QString &user )
+{
+	core::MutexLock lock( mutex );
+	std::set< QString >::iterator it = userSet.find( user );
+	if ( it != userSet.end() )
+		userSet.erase( it );
+	usersVersion++;
+	dirty = 1;
+}
+
+void LiveGameState::setMenuItem( const MenuItem &mi )
+{
+	core::MutexLock lock( mutex );
+	menu[ mi.id ] = mi;
+	menuVersion++;
+	dirty = 1;
+}
+
+void LiveGameState::clearMenu()
+{
+	core::MutexLock lock( mutex );
+	menu.clear();
+	menuVersion++;
+	dirty = 1;
+}
+
+// set engine info (PV starts from current live board)
+void LiveGameState::setEngineInfo( int color, int depth, int score, double nodes, double nps,
+	const QString &pv )
+{
+	core::MutexLock lock( mutex );
+	EngineInfo &ei = info.engine[color];
+	ei.version++;
+	ei.depth = depth;
+	ei.score = score;
+	ei.nodes = nodes;
+	ei.nps = nps;
+	ei.pv = pv;
+	ei.pvBoard = board;
+	touchInfo();
+}
+
+// set remaining time of player and opponent (cs)
+void LiveGameState::setTime( int color, double time, double otime )
+{
+	core::MutexLock lock( mutex );
+	info.time[ color ] = time;
+	info.time[ color ^ 1 ] = otime;
+	info.clockVersion++;
+	touchInfo();
+}
+
+void LiveGameState::setLevel( const QString &moves, const QString &time, const QString &inc )
+{
+	core::MutexLock lock( mutex );
+	info.levelMoves = moves;
+	info.levelTime = time;
+	info.levelInc = inc;
+	touchInfo();
+}
+
+void LiveGameState::setLastMove( const QString &txt )
+{
+	core::MutexLock lock( mutex );
+	info.lastMove = txt;
+	touchInfo();
+}
+
+void LiveGameState::setFiftyRule( const QString &txt )
+{
+	core::MutexLock lock( mutex );
+	info.fifty = txt;
+	touchInfo();
+}
+
+// set FEN text (as sent by server)
+void LiveGameState::setFEN( const QString &fen )
+{
+	core::MutexLock lock( mutex );
+	info.fen = fen;
+	touchInfo();
+}
+
+// start new game from FEN (only if not running)
+bool LiveGameState::startGame( const QString &fen )
+{
+	core::MutexLock lock( mutex );
+	if ( running )
+		return 0;
+	if ( fen.isEmpty() )
+		board.reset();
+	else
+	{
+		QByteArray arr = fen.toLatin1();
+		board.fromFEN( arr.constData() );
+	}
+	lastMove = cheng4::mcNone;
+	current.board = board;
+	current.moves.clear();
+	current.result.clear();
+	adjudicator.reset( board );
+	running = 1;
+	sequencer.clear();
+	touchBoard();
+	return 1;
+}
+
+// record applied moves into current game (no locking)
+void LiveGameState::recordMoves( const cheng4::Board &before, const std::vector< MoveSequencer::Applied > &moves )
+{
+	if ( moves.empty() )
+		return;
+	if ( current.moves.empty() )
+	{
+		current.board = before;
+		current.board.setMove( moves[0].moveNumber );
+		QDate date = QDate::currentDate();
+		current.date.sprintf("%04d.%02d.%02d", date.year(), date.month(), date.day() );
+		adjudicator.reset( before );
+	}
+	for ( size_t i=0; i<moves.size(); i++ )
+	{
+		current.moves.push_back( moves[i].move );
+		adjudicator.push( moves[i].move );
+	}
+	lastMove = moves.back().move;
+	touchBoard();
+}
+
+// apply move command (nn. SAN)
+LiveGameState::MoveResult LiveGameState::applyMove( int color, AckType ack, const char *c, int *applied )
+{
+	core::MutexLock lock( mutex );
+	if ( applied )
+		*applied = 0;
+	if ( !running )
+		return mrNotRunning;
+	std::vector< MoveSequencer::Applied > moves;
+	cheng4::Board before = board;
+	MoveSequencer::Result res = sequencer.submit( board, ack, color, c, moves );
+	recordMoves( before, moves );
+	if ( applied )
+		*applied = (int)moves.size();
+	switch( res )
+	{
+	case MoveSequencer::srApplied:
+		return mrApplied;
+	case MoveSequencer::srStale:
+		return mrStale;
+	default:
+		return mrBuffered;
+	}
+}
+
+// find up to depth plies leading from b to target signature
+bool LiveGameState::findBridge( const cheng4::Board &b, cheng4::Signature target, int depth,
+	std::vector< cheng4::Move > &path )
+{
+	if ( depth <= 0 )
+		return 0;
+	cheng4::MoveGen mg( b );
+	cheng4::Move m;
+	while ( (m = mg.next()) != cheng4::mcNone )
+	{
+		cheng4::Board tb( b );
+		cheng4::UndoInfo ui;
+		tb.doMove( m, ui, tb.isCheck( m, tb.discovered() ) );
+		if ( tb.sig() == target || findBridge( tb, target, depth-1, path ) )
+		{
+			path.insert( path.begin(), m );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// check server FEN against live board (running game only)
+LiveGameState::FenSync LiveGameState::syncFEN( AckType ack, const QString &fen )
+{
+	FenSync res;
+	res.result = fsIgnored;
+	res.local = res.remote = 0;
+	res.bridged = res.dropped = 0;
+
+	core::MutexLock lock( mutex );
+	if ( !running )
+		return res;
+	if ( sequencer.isStale( ack ) )
+	{
+		// delayed FEN, live board is already past it
+		res.result = fsStale;
+		return res;
+	}
+	cheng4::Board fb;
+	QByteArray arr = fen.toLatin1();
+	if ( !fb.fromFEN( arr.constData() ) )
+		return res;
+
+	res.local = board.sig();
+	res.remote = fb.sig();
+	if ( res.local == res.remote )
+	{
+		res.result = fsMatch;
+		return res;
+	}
+
+	std::vector< MoveSequencer::Applied > moves;
+	cheng4::Board before = board;
+	std::vector< cheng4::Move > path;
+	// try to recover lost move(s) first (up to two plies, i.e. one full move)
+	if ( findBridge( board, res.remote, 1, path ) || findBridge( board, res.remote, 2, path ) )
+	{
+		for ( size_t i=0; i<path.size(); i++ )
+		{
+			MoveSequencer::Applied a;
+			a.ack = ack;
+			a.move = path[i];
+			a.moveNumber = board.move();
+			cheng4::UndoInfo ui;
+			board.doMove( a.move, ui, board.isCheck( a.move, board.discovered() ) );
+			if ( board.turn() == cheng4::ctWhite )
+				board.incMove();
+			moves.push_back( a );
+		}
+		res.result = fsBridged;
+		res.bridged = (int)path.size();
+	}
+	else
+	{
+		// can't bridge the gap => close recorded moves as unfinished game
+		// and continue recording from FEN as a new one
+		if ( !current.moves.empty() )
+		{
+			pgn = getPGNInternal();
+			current.clear();
+		}
+		board = fb;
+		lastMove = cheng4::mcNone;
+		current.board = board;
+		adjudicator.reset( board );
+		before = board;
+		touchBoard();
+		res.result = fsResync;
+	}
+	// take server move counters
+	board.setMove( fb.move() );
+	res.dropped = (int)sequencer.resync( ack );
+	recordMoves( before, moves );
+	// continue with pending moves past the FEN
+	before = board;
+	moves.clear();
+	sequencer.flush( board, moves );
+	recordMoves( before, moves );
+	return res;
+}
+
+// get move sequencer stats (and number of pending moves)
+MoveSequencer::Stats LiveGameState::getSequencerStats( size_t *pending ) const
+{
+	core::MutexLock lock( mutex );
+	if ( pending )
+		*pending = sequencer.getPending();
+	return sequencer.getStats();
+}
+
+// get copy of live board
+cheng4::Board LiveGameState::getBoard() const
+{
+	core::MutexLock lock( mutex );
+	return board;
+}
+
+// get adjudication of live board
+Adjudicator::Status LiveGameState::getAdjudication() const
+{
+	core::MutexLock lock( mutex );
+	return adjudicator.getStatus();
+}
+
+QString LiveGameState::getPGNInternal() const
+{
+	QString res = pgn;
+	if ( !res.isEmpty() )
+		res += '\n';
+	res += current.toPGN( pgnFENCache );
+	return res;
+}
+
+// get PGN (finished games + current game)
+QString LiveGameState::getPGN() const
+{
+	core::MutexLock lock( mutex );
+	return getPGNInternal();
+}
+
+// add current game to finished games
+QString LiveGameState::addCurrent( bool fullReset )
+{
+	core::MutexLock lock( mutex );
+	pgn = getPGNInternal();
+	current.clear( fullReset );
+	dirty = 1;
+	return pgn;
+}
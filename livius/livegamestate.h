@@ -0,0 +1,275 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef LIVEGAMESTATE_H
+#define LIVEGAMESTATE_H
+
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include <set>
+#include <map>
+#include <vector>
+#include "core/thread.h"
+#include "chess/chess.h"
+#include "ack.h"
+#include "movesequencer.h"
+#include "adjudicator.h"
+
+// live game state (pure data, no widgets)
+// all methods are thread-safe; views never touch the working state directly,
+// instead they read immutable snapshots published by getSnapshot()
+class LiveGameState
+{
+public:
+	struct MenuItem
+	{
+		int id, width, height;
+		QString name, url;
+	};
+
+	typedef std::map< int, MenuItem > MenuMap;
+
+	struct CurrentGame
+	{
+		// a copy of current site name
+		QString site;
+		// current game pgn date
+		QString date;
+		// white player
+		QString white;
+		// black player
+		QString black;
+		// time control (m/)bs(+is)
+		QString timeControl;
+		// result
+		QString result;
+		// current game starting position
+		cheng4::Board board;
+		// list of current game moves
+		std::vector< cheng4::Move > moves;
+
+		// clear
+		void clear( bool full = 0 );
+		// get pgn as text (start position FEN through fens)
+		QString toPGN( cheng4::FENCache &fens ) const;
+	};
+
+	// engine info of one player (as sent by server)
+	struct EngineInfo
+	{
+		// bumped on each update
+		quint64 version;
+		int depth;
+		// score in cp
+		int score;
+		double nodes;
+		double nps;
+		// raw PV text
+		QString pv;
+		// live board the PV starts from
+		cheng4::Board pvBoard;
+
+		void clear();
+	};
+
+	// info panel data
+	struct Info
+	{
+		EngineInfo engine[ cheng4::ctMax ];
+		// remaining time for each player (cs)
+		double time[ cheng4::ctMax ];
+		// bumped on each time update
+		quint64 clockVersion;
+		// level: moves, base time, increment
+		QString levelMoves, levelTime, levelInc;
+		// last move text
+		QString lastMove;
+		// fifty move rule counter
+		QString fifty;
+		QString fen;
+	};
+
+	// immutable snapshot of the state
+	struct Snapshot
+	{
+		// versions of individual parts (views can skip parts that didn't change)
+		quint64 boardVersion;
+		quint64 usersVersion;
+		quint64 menuVersion;
+		quint64 infoVersion;
+		// game running?
+		bool running;
+		// live board
+		cheng4::Board board;
+		// last move (for highlighting, mcNone if none)
+		cheng4::Move lastMove;
+		// adjudication of live board
+		Adjudicator::Status adjudication;
+		// current game
+		CurrentGame game;
+		// connected users (sorted)
+		QStringList users;
+		MenuMap menu;
+		Info info;
+	};
+
+	typedef QSharedPointer< const Snapshot > SnapshotPtr;
+
+	enum MoveResult
+	{
+		mrNotRunning,	// game not running, move ignored
+		mrApplied,		// move applied
+		mrBuffered,		// move is illegal now, buffered until a move with lower ack arrives
+		mrStale			// move older than last applied move, ignored
+	};
+
+	LiveGameState();
+
+	// get latest snapshot (publishes a new one if state changed since last call)
+	SnapshotPtr getSnapshot() const;
+
+	bool isRunning() const;
+	void setRunning( bool flag );
+
+	void setSite( const QString &site );
+	// set player name (resets engine info of that player)
+	void setPlayer( int color, const QString &name );
+	// get player name
+	QString getPlayer( int color ) const;
+	void setTimeControl( const QString &tc );
+	// set result (finishes game)
+	void setResult( const QString &result );
+
+	void addUser( const QString &user );
+	void removeUser( const QString &user );
+
+	void setMenuItem( const MenuItem &mi );
+	void clearMenu();
+
+	// set engine info (PV starts from current live board)
+	void setEngineInfo( int color, int depth, int score, double nodes, double nps, const QString &pv );
+	// set remaining time of player and opponent (cs)
+	void setTime( int color, double time, double otime );
+	void setLevel( const QString &moves, const QString &time, const QString &inc );
+	void setLastMove( const QString &txt );
+	void setFiftyRule( const QString &txt );
+	// set FEN text (as sent by server)
+	void setFEN( const QString &fen );
+
+	// start new game from FEN (only if not running)
+	// returns 1 if started
+	bool startGame( const QString &fen );
+
+	// apply move command (nn. SAN)
+	// applied: number of moves actually applied (incl. buffered moves that became legal)
+	MoveResult applyMove( int color, AckType ack, const char *c, int *applied = 0 );
+
+	enum FenSyncResult
+	{
+		fsIgnored,		// game not running or invalid FEN
+		fsStale,		// FEN older than last applied move, ignored
+		fsMatch,		// FEN matches live board
+		fsBridged,		// live board was behind, missing move(s) recovered
+		fsResync		// desync, live board replaced by FEN
+	};
+
+	struct FenSync
+	{
+		FenSyncResult result;
+		// live board and FEN signatures
+		cheng4::Signature local, remote;
+		// number of recovered moves (fsBridged)
+		int bridged;
+		// number of unresolved pending moves dropped
+		int dropped;
+	};
+
+	// check server FEN against live board (running game only)
+	// compares Zobrist signatures, on mismatch tries to recover up to two missing plies
+	// and resyncs to FEN if that fails (moves recorded so far are kept as an unfinished game)
+	// FENs older than last applied move are ignored
+	FenSync syncFEN( AckType ack, const QString &fen );
+
+	// get move sequencer stats (and number of pending moves)
+	MoveSequencer::Stats getSequencerStats( size_t *pending = 0 ) const;
+
+	// get copy of live board
+	cheng4::Board getBoard() const;
+	// get adjudication of live board
+	Adjudicator::Status getAdjudication() const;
+
+	// get PGN (finished games + current game)
+	QString getPGN() const;
+	// add current game to finished games
+	// returns recorded PGN
+	QString addCurrent( bool fullReset = 0 );
+
+private:
+	mutable core::Mutex mutex;
+
+	// working state
+	bool running;
+	cheng4::Board board;
+	cheng4::Move lastMove;
+	MoveSequencer sequencer;
+	// tracks live board outcome (mate/draws)
+	Adjudicator adjudicator;
+	std::set< QString > userSet;
+	MenuMap menu;
+	// recorded (actual) pgn data of finished games
+	QString pgn;
+	// pgn data (current game)
+	CurrentGame current;
+	// info panel data
+	Info info;
+
+	// part versions
+	quint64 boardVersion;
+	quint64 usersVersion;
+	quint64 menuVersion;
+	quint64 infoVersion;
+
+	// FEN of live board (info panel)
+	cheng4::FENCache fenCache;
+	// FEN of current game starting position (same on every getPGN during a game)
+	mutable cheng4::FENCache pgnFENCache;
+
+	// latest published snapshot
+	mutable SnapshotPtr snapshot;
+	// state changed since last publish
+	mutable bool dirty;
+
+	// find up to depth plies leading from b to target signature
+	static bool findBridge( const cheng4::Board &b, cheng4::Signature target, int depth,
+		std::vector< cheng4::Move > &path );
+	// record applied moves into current game (no locking)
+	void recordMoves( const cheng4::Board &before, const std::vector< MoveSequencer::Applied > &moves );
+	QString getPGNInternal() const;
+	void touchBoard();
+	void touchInfo();
+};
+
+#endif // LIVEGAMESTATE_H
@@ -24,17 +24,27 @@ freely, subject to the following restrictions:
 */
 
 #include <QDateTime>
+#include <QTimer>
 #include "liveinfo.h"
 #include "ui_liveinfo.h"
 // FIXME: better (because of skipSpc)
 #include "tlcvclient.h"
 #include "chessboard.h"
+#include <string.h>
+
+// maximum UI update frequency (Hz)
+static const int maxUpdateRate = 30;
 
 LiveInfo::LiveInfo(QWidget *parent, PieceSet *pset) :
 	QWidget(parent),
 	ui(new Ui::LiveInfo),
+	state(0),
+	prettyPV(0),
+	pvTip(0),
 	flipped(0),
-	turn(-1)
+	turn(-1),
+	dirty(0),
+	flushTimer(0)
 {
 	ui->setupUi(this);
 	ui->boardWidget->hide();
@@ -48,6 +58,18 @@ LiveInfo::LiveInfo(QWidget *parent, PieceSet *pset) :
 	connect(ui->fenButton, SIGNAL(clicked()), this, SLOT(copyFEN()));
 	remTime[ cheng4::ctWhite ] = remTime[ cheng4::ctBlack ] = 0;
 	thinkTime[ cheng4::ctWhite ] = thinkTime[ cheng4::ctBlack ] = 0;
+	for ( cheng4::Color c = cheng4::ctWhite; c <= cheng4::ctBlack; c++ )
+	{
+		PlayerView &v = view[c];
+		v.depth = v.score = 0;
+		v.nodes = v.nps = 0;
+		v.remSec = v.thinkSec = -1;
+		v.board.reset();
+	}
+	flushTimer = new QTimer( this );
+	flushTimer->setSingleShot( 1 );
+	flushTimer->setInterval( 1000 / maxUpdateRate );
+	connect(flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
 }
 
 LiveInfo::~LiveInfo()
@@ -60,80 +82,106 @@ void LiveInfo::copyFEN()
 	sigCopyFEN();
 }
 
-// set fen string
-void LiveInfo::setFEN( const QString &fen )
-{
-	ui->fenEdit->setText( fen );
-	ui->fenEdit->setCursorPosition(0);
-}
-
-// get fen string
-QString LiveInfo::getFEN() const
+// mark fields dirty and schedule flush
+void LiveInfo::markDirty( unsigned flags )
 {
-	return ui->fenEdit->text();
+	dirty |= flags;
+	if ( !flushTimer->isActive() )
+		flushTimer->start();
 }
 
-// set player name
-void LiveInfo::setPlayer( int color, const QString &txt )
+// only set label text if it actually differs
+void LiveInfo::updateLabel( QLabel *label, const QString &txt )
 {
-	(color == cheng4::ctWhite ? ui->engineLabel : ui->engineLabel_2)->setText( txt );
-	// reset engine stats
-	setDepth( color, 0 );
-	setScore( color, 0 );
-	setNodes( color, 0, 0 );
-	setPV( color, QString() );
+	if ( label->text() != txt )
+		label->setText( txt );
 }
 
-// get player name
-QString LiveInfo::getPlayer( int color ) const
+// set text field, marks it dirty if changed
+void LiveInfo::setField( QString &field, const QString &txt, unsigned flag )
 {
-	return (color == cheng4::ctWhite ? ui->engineLabel : ui->engineLabel_2)->text();
-}
-
-// set depth
-void LiveInfo::setDepth( int color, int depth )
-{
-	QString str;
-	str.sprintf("%d", depth);
-	(color == cheng4::ctWhite ? ui->depthLabel : ui->depthLabel2)->setText( str );
-}
-
-// set score
-void LiveInfo::setScore( int color, int score )
-{
-	QString str;
-	str.sprintf("%+0.2lf", (double)score/100.0);
-	(color == cheng4::ctWhite ? ui->scoreLabel : ui->scoreLabel2)->setText( str );
+	if ( field == txt )
+		return;
+	field = txt;
+	markDirty( flag );
 }
 
-// set level/moves
-void LiveInfo::setLevelMoves( const QString &txt )
+// set state to pull from
+void LiveInfo::setState( const LiveGameState *st )
 {
-	ui->movesLabel->setText(txt);
+	state = st;
+	shown.clear();
+	sync();
 }
 
-// set level/time
-void LiveInfo::setLevelTime( const QString &txt )
+// set PV display options
+void LiveInfo::setPVOptions( bool pretty, bool pvtip )
 {
-	ui->timeLabel->setText(txt);
+	if ( prettyPV == pretty && pvTip == pvtip )
+		return;
+	prettyPV = pretty;
+	pvTip = pvtip;
+	markDirty( dfPV | (dfPV << dfColorShift) );
+	sync();
 }
 
-// set level/increment
-void LiveInfo::setLevelIncrement( const QString &txt )
+// get fen string
+QString LiveInfo::getFEN() const
 {
-	ui->incrementLabel->setText(txt);
+	return fen;
 }
 
-// set last move text
-void LiveInfo::setLastMove( const QString &txt )
+// pull latest state snapshot into view model
+void LiveInfo::pull()
 {
-	ui->lastLabel->setText( txt );
+	if ( !state )
+		return;
+	LiveGameState::SnapshotPtr snap = state->getSnapshot();
+	if ( snap == shown )
+		return;
+	LiveGameState::SnapshotPtr old = shown;
+	shown = snap;
+	if ( !old || old->boardVersion != snap->boardVersion )
+		setTurn( snap->board.turn() );
+	if ( old && old->infoVersion == snap->infoVersion )
+		return;
+	const LiveGameState::Info &si = snap->info;
+	for ( cheng4::Color c = cheng4::ctWhite; c <= cheng4::ctBlack; c++ )
+	{
+		bool white = c == cheng4::ctWhite;
+		updateLabel( white ? ui->engineLabel : ui->engineLabel_2,
+			white ? snap->game.white : snap->game.black );
+		const LiveGameState::EngineInfo &ei = si.engine[c];
+		if ( old && old->info.engine[c].version == ei.version )
+			continue;
+		PlayerView &v = view[c];
+		v.depth = ei.depth;
+		v.score = ei.score;
+		v.nodes = ei.nodes;
+		v.nps = ei.nps;
+		v.pv = ei.pv;
+		v.board = ei.pvBoard;
+		markDirty( (dfDepth | dfScore | dfNodes | dfPV) << (c*dfColorShift) );
+	}
+	if ( !old || old->info.clockVersion != si.clockVersion )
+	{
+		remTime[ cheng4::ctWhite ] = si.time[ cheng4::ctWhite ];
+		remTime[ cheng4::ctBlack ] = si.time[ cheng4::ctBlack ];
+		setTime();
+	}
+	setField( fen, si.fen, dfFEN );
+	setField( levelMoves, si.levelMoves, dfLevelMoves );
+	setField( levelTime, si.levelTime, dfLevelTime );
+	setField( levelInc, si.levelInc, dfLevelInc );
+	setField( lastMove, si.lastMove, dfLastMove );
+	setField( fifty, si.fifty, dfFifty );
 }
 
-// set fifty rule counter
-void LiveInfo::setFiftyRule( const QString &fifty )
+// pull latest state snapshot, dirty fields are flushed by flushTimer (rate-capped)
+// called from slots only; widgets mustn't be touched while painting
+void LiveInfo::sync()
 {
-	ui->fiftyLabel->setText( fifty );
+	pull();
 }
 
 static QString prettyFormat( double num )
@@ -143,19 +191,19 @@ static QString prettyFormat( double num )
 	return str;
 }
 
-// set nodes
-void LiveInfo::setNodes( int color, double nodes, double nps )
+// can char continue a SAN token?
+static inline bool isSANChar( char c )
 {
-	QString str;
-	str = prettyFormat(nodes);
-	(color == cheng4::ctWhite ? ui->nodesLabel : ui->nodesLabel2)->setText( str );
-	str = prettyFormat(nps);
-	(color == cheng4::ctWhite ? ui->npsLabel : ui->npsLabel2)->setText( str );
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '=';
 }
 
-// set PV
-void LiveInfo::setPV( int color, QString txt, bool pretty, bool pvtip, const cheng4::Board *board )
+// process pending PV (called from flush)
+void LiveInfo::updatePV( int color )
 {
+	const PlayerView &v = view[color];
+	QString txt = v.pv;
+	bool pretty = prettyPV;
+	bool pvtip = pvTip;
 	QWidget *bw = color == cheng4::ctWhite ? ui->boardWidget : ui->boardWidget2;
 	if ( !pretty )
 		pvtip = 0;
@@ -167,41 +215,60 @@ void LiveInfo::setPV( int color, QString txt, bool pretty, bool pvtip, const che
 			bw->hide();
 	}
 	// try to make PV more readable by converting it to SAN
-	if ( pretty && board )
+	if ( pretty )
 	{
-		pv[color].board = *board;
-		pv[color].moves.clear();
+		PVInfo &pi = pv[color];
+		if ( pi.moves.empty() || pi.board.sig() != v.board.sig() )
+		{
+			// different root => cache is useless
+			pi.clear();
+			pi.board = pi.tip = v.board;
+		}
 		QString prettyPV;
-		cheng4::Board tb = *board;
 		QByteArray arr = txt.toUtf8();
 		const char *c = arr.constData();
-		const char *merge = c;
-		bool first = 1;
-		bool foundMove = 0;
-		while ( *c )
+		// reuse cached prefix (each token spans from end of previous move to end of its move)
+		size_t reused = 0;
+		while ( reused < pi.tokens.size() )
 		{
-			if ( (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') )
-			{
-				// SAN!
-				cheng4::Move m = tb.fromSAN(c);
-				if ( m == cheng4::mcNone )
-					break;
-				merge = c;
-				foundMove = 1;
-				pv[color].moves.push_back(m);
-				bool ponder = first && color != tb.turn();
-				first = 0;
-				if ( ponder )
-					prettyPV += '(';
-				prettyPV += tb.toSAN(m).c_str();
-				if ( ponder )
-					prettyPV += ')';
-				prettyPV += ' ';
-				cheng4::UndoInfo ui;
-				tb.doMove( m, ui, tb.isCheck(m, tb.discovered()) );
-			} else c++;
+			const QByteArray &ct = pi.tokens[reused];
+			if ( strncmp( c, ct.constData(), (size_t)ct.size() ) || isSANChar( c[ct.size()] ) )
+				break;
+			c += ct.size();
+			prettyPV += pi.san[reused++];
 		}
-		pv[color].tip = tb;
+		// PV diverges here => continue from board after the reused prefix
+		cheng4::Board tb = pi.truncate( reused );
+
+		// decode the rest in one go
+		enum { MAX_PV = 256 };
+		cheng4::Move moves[ MAX_PV ];
+		const char *ends[ MAX_PV ];
+		cheng4::uint count = tb.decodeMoves( c, moves, MAX_PV, 0, 0, ends );
+		for ( cheng4::uint i=0; i<count; i++ )
+		{
+			cheng4::Move m = moves[i];
+			bool ponder = pi.moves.empty() && color != tb.turn();
+			QString san;
+			if ( ponder )
+				san += '(';
+			char buf[16];
+			*tb.toSAN( buf, m ) = 0;
+			san += QLatin1String( buf );
+			if ( ponder )
+				san += ')';
+			san += ' ';
+			prettyPV += san;
+			pi.moves.push_back(m);
+			pi.tokens.push_back( QByteArray( c, (int)(ends[i] - c) ) );
+			pi.san.push_back( san );
+			c = ends[i];
+			cheng4::UndoInfo ui;
+			tb.doMove( m, ui, tb.isCheck(m, tb.discovered()) );
+		}
+		const char *merge = c;
+		bool foundMove = !pi.moves.empty();
+		pi.tip = tb;
 		if ( foundMove )
 		{
 			// FIXME: HACK: only set if move is found, but I can't do anything about it unfortunately
@@ -212,43 +279,122 @@ void LiveInfo::setPV( int color, QString txt, bool pretty, bool pvtip, const che
 			txt += merge;
 		}
 	}
-	else pv[color].moves.clear();
+	else pv[color].clear();
 
 	QLineEdit *ed = (color == cheng4::ctWhite ? ui->pvEdit : ui->pvEdit_2);
-	ed->setText( txt );
-	ed->setCursorPosition(0);
+	if ( ed->text() != txt )
+	{
+		ed->setText( txt );
+		ed->setCursorPosition(0);
+	}
+}
+
+void LiveInfo::PVInfo::clear()
+{
+	moves.clear();
+	tokens.clear();
+	san.clear();
+}
+
+// drop cached moves past count, returns board after count moves
+cheng4::Board LiveInfo::PVInfo::truncate( size_t count )
+{
+	if ( count >= moves.size() )
+		return tip;
+	cheng4::Board tb = board;
+	for ( size_t i=0; i<count; i++ )
+	{
+		cheng4::UndoInfo ui;
+		tb.doMove( moves[i], ui, tb.isCheck( moves[i], tb.discovered() ) );
+	}
+	moves.resize( count );
+	tokens.resize( count );
+	san.resize( count );
+	return tb;
 }
 
 void LiveInfo::setTime()
 {
-	// just fill controls
+	// only mark dirty if displayed time changes
 	for ( cheng4::Color c = cheng4::ctWhite; c <= cheng4::ctBlack; c++ )
 	{
 		qint64 rt = (qint64)remTime[c];
 		if ( rt < 0 )
 			rt = 0;
 		rt /= 100;
-		int s = (int)(rt % 60);
-		int m = (int)((rt/60) % 60);
-		int h = (int)((rt/3600));
-		QString str;
-		str.sprintf("%02d:%02d:%02d", h, m, s);
-		(c == cheng4::ctWhite ? ui->remainingLabel : ui->remainingLabel_2)->setText(str);
 		qint64 pt = (qint64)thinkTime[c];
 		pt /= 100;
-		s = (int)(pt % 60);
-		m = (int)((pt/60) % 60);
-		str.sprintf("%02d:%02d", m, s);
-		(c == cheng4::ctWhite ? ui->actualLabel : ui->actualLabel_2)->setText(str);
+		PlayerView &v = view[c];
+		if ( rt != v.remSec || pt != v.thinkSec )
+		{
+			v.remSec = rt;
+			v.thinkSec = pt;
+			markDirty( dfTime << (c*dfColorShift) );
+		}
 	}
 }
 
-// set time
-void LiveInfo::setTime( int color, double time, double otim )
+// flush dirty fields to widgets
+void LiveInfo::flush()
 {
-	remTime[ color ] = time;
-	remTime[ color ^ 1 ] = otim;
-	setTime();
+	unsigned flags = dirty;
+	dirty = 0;
+	QString str;
+	for ( cheng4::Color c = cheng4::ctWhite; c <= cheng4::ctBlack; c++ )
+	{
+		unsigned cf = flags >> (c*dfColorShift);
+		const PlayerView &v = view[c];
+		bool white = c == cheng4::ctWhite;
+		if ( cf & dfDepth )
+		{
+			str.sprintf("%d", v.depth);
+			updateLabel( white ? ui->depthLabel : ui->depthLabel2, str );
+		}
+		if ( cf & dfScore )
+		{
+			str.sprintf("%+0.2lf", (double)v.score/100.0);
+			updateLabel( white ? ui->scoreLabel : ui->scoreLabel2, str );
+		}
+		if ( cf & dfNodes )
+		{
+			updateLabel( white ? ui->nodesLabel : ui->nodesLabel2, prettyFormat(v.nodes) );
+			updateLabel( white ? ui->npsLabel : ui->npsLabel2, prettyFormat(v.nps) );
+		}
+		if ( cf & dfPV )
+			updatePV( c );
+		if ( cf & dfTime )
+		{
+			qint64 rt = v.remSec;
+			int s = (int)(rt % 60);
+			int m = (int)((rt/60) % 60);
+			int h = (int)((rt/3600));
+			str.sprintf("%02d:%02d:%02d", h, m, s);
+			updateLabel( white ? ui->remainingLabel : ui->remainingLabel_2, str );
+			qint64 pt = v.thinkSec;
+			s = (int)(pt % 60);
+			m = (int)((pt/60) % 60);
+			str.sprintf("%02d:%02d", m, s);
+			updateLabel( white ? ui->actualLabel : ui->actualLabel_2, str );
+		}
+	}
+	if ( flags & dfFEN )
+	{
+		if ( ui->fenEdit->text() != fen )
+		{
+			ui->fenEdit->setText( fen );
+			ui->fenEdit->setCursorPosition(0);
+		}
+	}
+	if ( flags & dfLevelMoves )
+		updateLabel( ui->movesLabel, levelMoves );
+	if ( flags & dfLevelTime )
+		updateLabel( ui->timeLabel, levelTime );
+	if ( flags & dfLevelInc )
+		updateLabel( ui->incrementLabel, levelInc );
+	if ( flags & dfLastMove )
+		updateLabel( ui->lastLabel, lastMove );
+	if ( flags & dfFifty )
+		updateLabel( ui->fiftyLabel, fifty );
 }
 
 // set turn
@@ -30,6 +30,7 @@ freely, subject to the following restrictions:
 #include <vector>
 #include "sig/signal.h"
 #include "chess/chess.h"
+#include "livegamestate.h"
 
 namespace Ui {
 class LiveInfo;
@@ -37,6 +38,8 @@ class LiveInfo;
 
 class PieceSet;
 class ChessBoard;
+class QLabel;
+class QTimer;
 
 class LiveInfo : public QWidget
 {
@@ -46,45 +49,23 @@ public:
 	explicit LiveInfo(QWidget *parent = 0, PieceSet *pset = 0);
 	~LiveInfo();
 
-	// set fen string
-	void setFEN( const QString &fen );
+	// set state to pull from
+	void setState( const LiveGameState *st );
+	// set PV display options
+	// pretty PV: parse and replace
+	void setPVOptions( bool pretty, bool pvtip );
 	// get fen string
 	QString getFEN() const;
 
-	// set player name
-	void setPlayer( int color, const QString &txt );
-	// get player name
-	QString getPlayer( int color ) const;
-	// set depth
-	void setDepth( int color, int depth );
-	// set score (cp)
-	void setScore( int color, int score );
-	// set nodes
-	void setNodes( int color, double nodes, double nps );
-	// set PV
-	// pretty PV: parse and replace
-	void setPV( int color, QString txt, bool pretty = 0, bool pvtip = 0, const cheng4::Board *board = 0 );
-	// set time
-	void setTime( int color, double time, double otim );
-	// set turn
-	void setTurn( int color );
-	// set level/moves
-	void setLevelMoves( const QString &txt );
-	// set level/time
-	void setLevelTime( const QString &txt );
-	// set level/increment
-	void setLevelIncrement( const QString &txt );
-	// set last move text
-	void setLastMove( const QString &txt );
-	// set fifty rule counter
-	void setFiftyRule( const QString &fifty );
-
 	// visually flip players
 	void flipPlayers();
 
 	// refresh (to update times)
 	void refresh();
 
+	// pull latest state snapshot (widgets are updated by rate-capped flush)
+	void sync();
+
 	Ui::LiveInfo *getUI() const
 	{
 		return ui;
@@ -94,9 +75,55 @@ public:
 
 private slots:
 	void copyFEN();
+	// flush dirty fields to widgets
+	void flush();
 
 private:
+	// pull latest state snapshot into view model
+	void pull();
 	void setTime();
+	// set turn
+	void setTurn( int color );
+	// set text field, marks it dirty if changed
+	void setField( QString &field, const QString &txt, unsigned flag );
+	// mark fields dirty and schedule flush
+	void markDirty( unsigned flags );
+	// only set label text if it actually differs
+	static void updateLabel( QLabel *label, const QString &txt );
+	// process pending PV (called from flush)
+	void updatePV( int color );
+
+	// dirty flags (per color flags are shifted left by color*dfColorShift)
+	enum DirtyFlags
+	{
+		dfDepth			=	1,
+		dfScore			=	2,
+		dfNodes			=	4,
+		dfPV			=	8,
+		dfTime			=	16,
+		dfColorShift	=	5,
+		dfFEN			=	1 << 10,
+		dfLevelMoves	=	1 << 11,
+		dfLevelTime		=	1 << 12,
+		dfLevelInc		=	1 << 13,
+		dfLastMove		=	1 << 14,
+		dfFifty			=	1 << 15
+	};
+
+	// view model (per player)
+	struct PlayerView
+	{
+		int depth;
+		int score;
+		double nodes;
+		double nps;
+		// displayed remaining/thinking time in seconds
+		qint64 remSec;
+		qint64 thinkSec;
+		// latest PV text (raw) + board it starts from
+		QString pv;
+		cheng4::Board board;
+	};
 
 	struct PVInfo
 	{
@@ -104,9 +131,24 @@ private:
 		// both are valiad only if moves isn't empty
 		cheng4::Board board, tip;
 		std::vector< cheng4::Move > moves;
+		// conversion cache (parallel to moves): raw PV tokens and converted SAN text
+		// successive PVs from the same root usually share a prefix which doesn't need to be converted again
+		std::vector< QByteArray > tokens;
+		std::vector< QString > san;
+
+		void clear();
+		// drop cached moves past count, returns board after count moves
+		cheng4::Board truncate( size_t count );
 	};
 
 	Ui::LiveInfo *ui;
+	// state to pull from (not owned)
+	const LiveGameState *state;
+	// snapshot currently shown
+	LiveGameState::SnapshotPtr shown;
+	// PV display options
+	bool prettyPV;
+	bool pvTip;
 	// players flipped flag
 	bool flipped;
 	// remaining time for each player (cs)
@@ -120,6 +162,13 @@ private:
 	// time stamp
 	qint64 stamp;
 	ChessBoard *boards[ cheng4::ctMax ];
+	// view model
+	PlayerView view[ cheng4::ctMax ];
+	QString fen, levelMoves, levelTime, levelInc, lastMove, fifty;
+	// dirty fields
+	unsigned dirty;
+	// single-shot timer capping widget update rate
+	QTimer *flushTimer;
 };
 
 #endif // LIVEINFO_H
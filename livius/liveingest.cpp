@@ -0,0 +1,595 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "liveingest.h"
+#include "livegamestate.h"
+#include "tlcvclient.h"
+#include "enginestats.h"
+#include "config/token.h"
+#include <QThread>
+#include <QTimer>
+#include <QMetaType>
+#include <QCoreApplication>
+#include <string.h>
+
+using namespace config;
+
+LiveIngest::LiveIngest( LiveGameState &state_, const QString &nick_ ) : state(state_), thread(0),
+	client(0), timer(0), nick(nick_), port(0), statsLog(0), changePending(0),
+	adjudication(Adjudicator::asNone)
+{
+	qRegisterMetaType< quint64 >( "quint64" );
+	thread = new QThread;
+}
+
+LiveIngest::~LiveIngest()
+{
+	stop();
+	delete thread;
+}
+
+// start ingest thread and connect to server
+void LiveIngest::start( const QString &url_, quint16 port_ )
+{
+	url = url_;
+	port = port_;
+	moveToThread( thread );
+	connect( thread, SIGNAL(started()), this, SLOT(init()) );
+	thread->start();
+}
+
+// stop ingest thread (waits for it to finish)
+void LiveIngest::stop()
+{
+	if ( !thread->isRunning() )
+		return;
+	QMetaObject::invokeMethod( this, "shutdown", Qt::BlockingQueuedConnection );
+	thread->quit();
+	thread->wait();
+}
+
+// runs in ingest thread
+void LiveIngest::init()
+{
+	client = new TLCVClient( nick );
+	client->sigCommand.connect( this, &LiveIngest::parseCommand );
+	client->sigConnectionError.connect( this, &LiveIngest::connectionError );
+	client->sigDebugSend.connect( this, &LiveIngest::onDebugSend );
+	client->sigDebugReceive.connect( this, &LiveIngest::onDebugReceive );
+	client->sigDebugQueue.connect( this, &LiveIngest::onDebugQueue );
+
+	timer = new QTimer( this );
+	connect(timer, SIGNAL(timeout()), this, SLOT(onTimer()));
+	// we want timer to be more responsive
+	timer->start(250);
+
+	client->connectTo( url, port );
+}
+
+void LiveIngest::shutdown()
+{
+	delete timer;
+	timer = 0;
+	delete client;
+	client = 0;
+	// hand ourselves back to GUI thread so that we can be deleted there
+	moveToThread( QCoreApplication::instance()->thread() );
+}
+
+void LiveIngest::onTimer()
+{
+	client->refresh();
+}
+
+// set engine stats log (may be 0)
+void LiveIngest::setStatsLog( EngineStatsLog *log )
+{
+	core::MutexLock lock( logMutex );
+	statsLog = log;
+}
+
+// acknowledge stateChanged (called from GUI thread before reading state)
+void LiveIngest::ackStateChanged()
+{
+	changePending.fetchAndStoreOrdered( 0 );
+}
+
+// notify GUI that state changed
+void LiveIngest::notifyChanged()
+{
+	if ( changePending.testAndSetOrdered( 0, 1 ) )
+		emit stateChanged();
+}
+
+void LiveIngest::chat( const QString &msg )
+{
+	client->chat( msg );
+}
+
+void LiveIngest::setNick( const QString &newNick )
+{
+	client->setNick( newNick );
+}
+
+void LiveIngest::getCrossTable()
+{
+	client->getCrossTable();
+}
+
+void LiveIngest::getGameList()
+{
+	client->getGameList();
+}
+
+void LiveIngest::send( const QString &msg )
+{
+	client->send( msg );
+}
+
+void LiveIngest::reconnect()
+{
+	client->disconnect();
+	state.clearMenu();
+	state.setRunning(0);
+	addCurrent(1);
+	notifyChanged();
+	client->reconnect();
+}
+
+// add current game to finished games
+void LiveIngest::addCurrent( bool fullReset )
+{
+	QString pgn = state.addCurrent( fullReset );
+	if ( !pgn.isEmpty() )
+		emit pgnChanged( pgn );
+}
+
+// report new adjudication status
+void LiveIngest::checkAdjudication()
+{
+	Adjudicator::Status st = state.getAdjudication();
+	if ( st == adjudication )
+		return;
+	adjudication = st;
+	if ( st != Adjudicator::asNone && state.isRunning() )
+	{
+		QString msg;
+		msg.sprintf( "Adjudication: %s", Adjudicator::getStatusText( st ) );
+		emit message( MSG_INFO, msg );
+	}
+}
+
+void LiveIngest::onDebugSend( const QString &msg, bool ok )
+{
+	emit debugSend( msg, ok );
+}
+
+void LiveIngest::onDebugReceive( const QByteArray &msg )
+{
+	emit debugReceive( msg );
+}
+
+void LiveIngest::onDebugQueue( size_t size )
+{
+	emit debugQueue( (int)size, client->getShedCount() );
+}
+
+void LiveIngest::debugSequencerStats()
+{
+	size_t pending = 0;
+	MoveSequencer::Stats st = state.getSequencerStats( &pending );
+	emit debugSequencer( st.applied, st.stale, st.resyncs, st.gaps, (int)pending );
+}
+
+void LiveIngest::parsePV( int color, const char *c )
+{
+	TLCVClient::skipSpc( c );
+	const char *beg = c;
+	// here comes depth
+	TLCVClient::skipNonSpc( c );
+	int depth = QString( (std::string(beg, c-beg)).c_str() ).toInt();
+	// here comes centipawn score
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	int score = QString( (std::string(beg, c-beg)).c_str() ).toInt();
+	// here comes time in hundreds of seconds
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	int timehs = QString( (std::string(beg, c-beg)).c_str() ).toInt();
+	// here comee nodes
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	qint64 inodes = QString( (std::string(beg, c-beg)).c_str() ).toLongLong();
+	double nodes = (double)inodes;
+	double nps = timehs ? nodes * 100.0 / timehs : 0;
+	TLCVClient::skipSpc( c );
+	// the rest is pv
+	state.setEngineInfo( color, depth, score, nodes, nps, QString( c ).trimmed() );
+	core::MutexLock lock( logMutex );
+	if ( statsLog )
+		statsLog->addPV( state.getPlayer( color ), color, depth, score, timehs, inodes );
+}
+
+void LiveIngest::parseTime( int color, const char *c )
+{
+	TLCVClient::skipSpc( c );
+	const char *beg = c;
+	// here comes depth
+	TLCVClient::skipNonSpc( c );
+	double time = (double)QString( (std::string(beg, c-beg)).c_str() ).toLongLong();
+	// otim follows - just ignore
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	double otime = (double)QString( (std::string(beg, c-beg)).c_str() ).toLongLong();
+	state.setTime( color, time, otime );
+}
+
+void LiveIngest::parseLevel( const char *c )
+{
+	TLCVClient::skipSpc( c );
+	const char *beg = c;
+	// here comes moves
+	TLCVClient::skipNonSpc( c );
+	QString moves = QString( (std::string(beg, c-beg)).c_str() );
+	// here comes time
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	QString base = QString( (std::string(beg, c-beg)).c_str() );
+	// here comes increment
+	TLCVClient::skipSpc( c );
+	beg = c;
+	TLCVClient::skipNonSpc( c );
+	QString increment = QString( (std::string(beg, c-beg)).c_str() );
+	state.setLevel( moves, base, increment );
+
+	// now convert level to PGN string...
+	int imoves = 0, itime = 0, iinc = 0;
+	bool ok = 0;
+	imoves = moves.toInt(&ok);
+	if ( !ok )
+		imoves = 0;
+	// base could be either mm or mm:ss
+	int icolon = base.lastIndexOf(':');
+	if ( icolon < 0 )
+	{
+		// just minutes...
+		itime = base.toInt(&ok);
+		if ( !ok )
+			itime = 0;
+		itime *= 60;
+	}
+	else
+	{
+		// composite => separate minutes and seconds
+		QString mins = base.left(icolon);
+		QString secs = base.right( base.length() - icolon - 1 );
+		itime = mins.toInt(&ok);
+		if ( !ok )
+			itime = 0;
+		itime *= 60;
+		int isecs = 0;
+		isecs = secs.toInt(&ok);
+		if ( !ok )
+			isecs = 0;
+		itime += isecs;
+	}
+	iinc = increment.toInt(&ok);
+	if ( !ok )
+		iinc = 0;
+	QString tc;
+	if ( imoves != 0 )
+		tc.sprintf("%d/", imoves);
+	QString tmp;
+	tmp.sprintf("%d", itime);
+	tc += tmp;
+	if ( iinc != 0 )
+	{
+		tmp.sprintf("+%d", iinc);
+		tc += tmp;
+	}
+	state.setTimeControl( tc );
+}
+
+bool LiveIngest::parseMove( int color, AckType ack, const char *c )
+{
+	const char *move = c;
+	TLCVClient::skipSpc( c );
+	const char *beg = c;
+	// here comes move number (nn.)
+	TLCVClient::skipNonSpc( c );
+	int mnum = (int)QString( (std::string(beg, c-beg)).c_str() ).toDouble();
+	TLCVClient::skipSpc( c );
+
+	cheng4::Board b = state.getBoard();
+	int applied = 0;
+	LiveGameState::MoveResult res = state.applyMove( color, ack, move, &applied );
+	if ( res == LiveGameState::mrNotRunning )
+	{
+		QString warn;
+		warn.sprintf("Warning: got %cmove: %s but game is not running",
+			color == cheng4::ctWhite ? 'w' : 'b', move);
+		emit message( MSG_INFO, warn );
+		return 0;
+	}
+
+	QString infoMove;
+	infoMove.sprintf("%d.", mnum);
+	if ( color == cheng4::ctBlack )
+		infoMove += "..";
+	infoMove += c;
+	state.setLastMove( infoMove );
+
+	if ( applied )
+	{
+		checkAdjudication();
+		emit pgnChanged( state.getPGN() );
+	}
+	if ( res == LiveGameState::mrApplied )
+		return 1;
+	if ( res == LiveGameState::mrStale )
+		return 0;
+	// FIXME: this is debug code now so that I know the fix works
+	QString err;
+	char fen[256];
+	*b.toFEN( fen ) = 0;
+	err.sprintf("Got illegal %cmove: %s, FEN = %s", color == cheng4::ctWhite ? 'w' : 'b',
+		c, fen);
+	emit message( MSG_INFO, err );
+	return 0;
+}
+
+void LiveIngest::connectionError( int err )
+{
+	state.setRunning(0);
+	addCurrent();
+	notifyChanged();
+	switch( err )
+	{
+	case TLCVClient::ERR_CONNFAILED:
+		emit message( MSG_ERROR, "Failed to connect to server!" );
+		break;
+	case TLCVClient::ERR_CONNLOST:
+		emit message( MSG_ERROR, "Connection lost with server!" );
+		break;
+	default:
+		emit message( MSG_ERROR, "Unknown connection problem" );
+	}
+}
+
+bool LiveIngest::parseMenu( const char * c )
+{
+	config::TokenType tt;
+	Token tok;
+	int line = 1;
+	// should be ID=n WIDTH=n HEIGHT=n NAME=str URL=str
+	const char *top = c + strlen(c);
+	i32 id = -1;
+	i32 width = -1;
+	i32 height = -1;
+	QString name, url;
+	for (;;)
+	{
+		tt = getToken(line, c, top, tok);
+		if ( tt != ttIdent )
+			break;
+		QString ident = tok.text;
+		tt = getToken(line, c, top, tok);
+		if ( tt != ttAssign )
+			return 0;
+		tt = getToken(line, c, top, tok);
+		if ( tt != ttInt && tt != ttString )
+			return 0;
+		if ( ident == "NAME" )
+		{
+			if ( tt != ttString )
+				return 0;
+			name = tok.text;
+		}
+		else if ( ident == "URL" )
+		{
+			if ( tt != ttString )
+				return 0;
+			url = tok.text;
+		}
+		else if ( ident == "ID" )
+		{
+			if ( tt != ttInt )
+				return 0;
+			id = tok.iconst;
+		}
+		else if ( ident == "WIDTH" )
+		{
+			if ( tt != ttInt )
+				return 0;
+			width = tok.iconst;
+		}
+		else if ( ident == "HEIGHT" )
+		{
+			if ( tt != ttInt )
+				return 0;
+			height = tok.iconst;
+		}
+	}
+	LiveGameState::MenuItem mi;
+	mi.id = (int)id;
+	mi.width = (int)width;
+	mi.height = (int)height;
+	mi.name = name;
+	mi.url = url;
+	state.setMenuItem( mi );
+	return 1;
+}
+
+void LiveIngest::parseCommand( int cmd, AckType ack, const char *c )
+{
+	QString str;
+	// game state touched?
+	bool changed = 1;
+	switch( cmd )
+	{
+	case TLCVClient::CMD_MENU:
+		// parse menu!
+		changed = parseMenu(c);
+		break;
+	case TLCVClient::CMD_SITE:
+		str = c;
+		state.setSite( str );
+		emit siteChanged( str.trimmed() );
+		break;
+	case TLCVClient::CMD_LOGON:
+		emit message( MSG_INFO, "Logon successful" );
+		changed = 0;
+		break;
+	case TLCVClient::CMD_GL:
+		str = c;
+		str.insert(5, "  ");
+		emit gameListAdd( str );
+		changed = 0;
+		break;
+	case TLCVClient::CMD_CTRESET:
+		emit crossTableClear();
+		changed = 0;
+		break;
+	case TLCVClient::CMD_CT:
+		str = c;
+		emit crossTableAdd( str );
+		changed = 0;
+		break;
+	case TLCVClient::CMD_ADDUSER:
+		str = c;
+		state.addUser( str.trimmed() );
+		break;
+	case TLCVClient::CMD_DELUSER:
+		str = c;
+		state.removeUser( str.trimmed() );
+		break;
+	case TLCVClient::CMD_FEN:
+		str = c;
+		// starts a new game if not running
+		if ( !state.startGame( str ) )
+		{
+			// verify live board against server FEN (resync on mismatch)
+			LiveGameState::FenSync fs = state.syncFEN( ack, str );
+			if ( fs.result == LiveGameState::fsBridged || fs.result == LiveGameState::fsResync )
+			{
+				QString msg;
+				msg.sprintf("Board desync at ack %lu (local %016llx, server %016llx): ",
+					(unsigned long)ack, (unsigned long long)fs.local, (unsigned long long)fs.remote);
+				QString tmp;
+				if ( fs.result == LiveGameState::fsBridged )
+					tmp.sprintf("recovered %d missing move(s)", fs.bridged);
+				else
+					tmp.sprintf("resynced from FEN, %d unresolved move(s) dropped", fs.dropped);
+				emit message( MSG_INFO, msg + tmp );
+				emit pgnChanged( state.getPGN() );
+			}
+			else if ( fs.result == LiveGameState::fsStale )
+			{
+				// don't show outdated position
+				changed = 0;
+				break;
+			}
+		}
+		debugSequencerStats();
+		checkAdjudication();
+		state.setFEN( str.trimmed() );
+		break;
+	case TLCVClient::CMD_CHAT:
+		str = c;
+		emit message( MSG_TEXT, str.trimmed() );
+		changed = 0;
+		break;
+	case TLCVClient::CMD_MSG:
+	case TLCVClient::CMD_SECUSER:
+		str = c;
+		emit message( MSG_INFO, str.trimmed() );
+		changed = 0;
+		break;
+	case TLCVClient::CMD_WPLAYER:
+		str = c;
+		state.setPlayer( cheng4::ctWhite, str.trimmed() );
+		break;
+	case TLCVClient::CMD_BPLAYER:
+		str = c;
+		state.setPlayer( cheng4::ctBlack, str.trimmed() );
+		break;
+	case TLCVClient::CMD_WPV:
+		parsePV( cheng4::ctWhite, c );
+		break;
+	case TLCVClient::CMD_BPV:
+		parsePV( cheng4::ctBlack, c );
+		break;
+	case TLCVClient::CMD_WTIME:
+		parseTime( cheng4::ctWhite, c );
+		break;
+	case TLCVClient::CMD_BTIME:
+		parseTime( cheng4::ctBlack, c );
+		break;
+	case TLCVClient::CMD_LEVEL:
+		parseLevel( c );
+		break;
+	case TLCVClient::CMD_WMOVE:
+		parseMove( cheng4::ctWhite, ack, c );
+		debugSequencerStats();
+		break;
+	case TLCVClient::CMD_BMOVE:
+		parseMove( cheng4::ctBlack, ack, c );
+		debugSequencerStats();
+		break;
+	case TLCVClient::CMD_RESULT:
+		// finish result
+	{
+		str = c;
+		QString result = str.trimmed();
+		state.setResult( result );
+		// notify in chat window
+		str = state.getPlayer(cheng4::ctWhite);
+		str += " - ";
+		str += state.getPlayer(cheng4::ctBlack);
+		str += "  ";
+		str += result;
+		emit message( MSG_INFO, str );
+		// add current game
+		addCurrent();
+		break;
+	}
+	case TLCVClient::CMD_FMR:
+		str = c;
+		state.setFiftyRule( str.trimmed() );
+		break;
+	default:
+		changed = 0;
+	}
+	if ( changed )
+		notifyChanged();
+}
@@ -0,0 +1,148 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef LIVEINGEST_H
+#define LIVEINGEST_H
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include "core/thread.h"
+#include "ack.h"
+#include "adjudicator.h"
+
+class QThread;
+class QTimer;
+class TLCVClient;
+class EngineStatsLog;
+class LiveGameState;
+
+// TLCV ingest
+// owns the client (and its socket) and runs it in a separate thread, so that network traffic and
+// protocol parsing don't compete with painting; game state commands are applied to LiveGameState
+// directly, everything else is forwarded to the GUI thread through (queued) signals
+// public slots are meant to be invoked from GUI thread via queued connections
+class LiveIngest : public QObject
+{
+	Q_OBJECT
+public:
+	enum MessageType
+	{
+		MSG_TEXT,		// chat text
+		MSG_INFO,		// info message
+		MSG_ERROR		// error message
+	};
+
+	LiveIngest( LiveGameState &state, const QString &nick );
+	~LiveIngest();
+
+	// start ingest thread and connect to server
+	void start( const QString &url, quint16 port );
+	// stop ingest thread (waits for it to finish)
+	void stop();
+
+	// set engine stats log (may be 0)
+	void setStatsLog( EngineStatsLog *log );
+
+	// acknowledge stateChanged (called from GUI thread before reading state)
+	void ackStateChanged();
+
+signals:
+	// state changed; coalesced: not sent again until acknowledged
+	void stateChanged();
+	// chat/info/error message
+	void message( int type, const QString &txt );
+	void siteChanged( const QString &site );
+	// clear crosstable
+	void crossTableClear();
+	// add to crosstable
+	void crossTableAdd( const QString &str );
+	// add to gamelist
+	void gameListAdd( const QString &str );
+	void pgnChanged( const QString &pgn );
+
+	// for debugging purposes:
+	void debugSend( const QString &msg, bool ok );
+	void debugReceive( const QByteArray &msg );
+	// outgoing reliable queue size, number of PV/time updates dropped by load shedding
+	void debugQueue( int size, quint64 shed );
+	// move sequencer counters (applied, stale, resyncs, unresolved gaps) and pending moves
+	void debugSequencer( quint64 applied, quint64 stale, quint64 resyncs, quint64 gaps, int pending );
+
+public slots:
+	// send chat message
+	void chat( const QString &msg );
+	void setNick( const QString &nick );
+	void reconnect();
+	// send crosstable command
+	void getCrossTable();
+	// send game list command
+	void getGameList();
+	// send raw message
+	void send( const QString &msg );
+
+private slots:
+	// runs in ingest thread
+	void init();
+	void shutdown();
+	void onTimer();
+
+private:
+	LiveGameState &state;
+	QThread *thread;
+	// created in ingest thread
+	TLCVClient *client;
+	QTimer *timer;
+	QString nick, url;
+	quint16 port;
+	// engine stats log (not owned)
+	EngineStatsLog *statsLog;
+	core::Mutex logMutex;
+	// stateChanged sent but not acknowledged yet
+	QAtomicInt changePending;
+	// last reported adjudication status
+	Adjudicator::Status adjudication;
+
+	// notify GUI that state changed
+	void notifyChanged();
+	// add current game to finished games
+	void addCurrent( bool fullReset = 0 );
+	// report new adjudication status
+	void checkAdjudication();
+	bool parseMenu( const char *c );
+	void parsePV( int color, const char *c );
+	void parseTime( int color, const char *c );
+	void parseLevel( const char *c );
+	bool parseMove( int color, AckType ack, const char *c );
+	void parseCommand( int cmd, AckType ack, const char *c );
+	void connectionError( int err );
+	void onDebugSend( const QString &msg, bool ok );
+	void onDebugReceive( const QByteArray &msg );
+	void onDebugQueue( size_t size );
+	// send move sequencer stats to debug console
+	void debugSequencerStats();
+};
+
+#endif // LIVEINGEST_H
@@ -22,19 +22,27 @@ SOURCES += main.cpp\
     liveframe.cpp \
     chatinfo.cpp \
     tlcvclient.cpp \
+    liveingest.cpp \
     connectiondialog.cpp \
     resultsdialog.cpp \
     emailgamedialog.cpp \
     pgndialog.cpp \
     chathighlight.cpp \
     aboutdialog.cpp \
-    debugconsoledialog.cpp
+    debugconsoledialog.cpp \
+    enginestats.cpp \
+    livegamestate.cpp \
+    movesequencer.cpp \
+    gametimeline.cpp \
+    movelistmodel.cpp \
+    adjudicator.cpp
 
 HEADERS  += mainwindow.h \
     liveinfo.h \
     liveframe.h \
     chatinfo.h \
     tlcvclient.h \
+    liveingest.h \
     connectiondialog.h \
     resultsdialog.h \
     emailgamedialog.h \
@@ -42,7 +50,13 @@ HEADERS  += mainwindow.h \
     chathighlight.h \
     aboutdialog.h \
     debugconsoledialog.h \
-    ack.h
+    ack.h \
+    enginestats.h \
+    livegamestate.h \
+    movesequencer.h \
+    gametimeline.h \
+    movelistmodel.h \
+    adjudicator.h
 
 FORMS    += mainwindow.ui \
     liveinfo.ui \
@@ -28,11 +28,25 @@ freely, subject to the following restrictions:
 #include <QFont>
 #include "chess/chess.h"
 #include "core/apppath.h"
+#include "enginestats.h"
+#include <string.h>
+#include <stdio.h>
 
 int main(int argc, char *argv[])
 {
 	ChessInit init;
 	(void)init;
+	// livius -statscsv <log> <csv>: convert engine stats log to CSV and exit
+	if ( argc == 4 && strcmp( argv[1], "-statscsv" ) == 0 )
+	{
+		QString error;
+		if ( !EngineStatsLog::exportCSV( QString::fromLocal8Bit(argv[2]), QString::fromLocal8Bit(argv[3]), &error ) )
+		{
+			fprintf( stderr, "%s\n", error.toLocal8Bit().constData() );
+			return 1;
+		}
+		return 0;
+	}
 	QApplication a(argc, argv);
 	MainWindow w( core::getAppPath() );
 	if ( w.isMaxWindow() )
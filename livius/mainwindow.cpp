@@ -29,6 +29,7 @@ freely, subject to the following restrictions:
 #include <QMdiSubWindow>
 #include <QColorDialog>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QFontDialog>
 #include "liveinfo.h"
@@ -42,6 +43,7 @@ freely, subject to the following restrictions:
 #include "aboutdialog.h"
 #include "debugconsoledialog.h"
 #include "config/config.h"
+#include "enginestats.h"
 
 const int defWidth  = 800;
 const int defHeight = 600;
@@ -72,6 +74,7 @@ void MainWindow::initConfig()
 	// add all configs here
 	LiveFrame::addConfig( cfgRoot );
 	ChessBoard::addConfig( cfgRoot );
+	EngineStatsLog::addConfig( cfgRoot );
 
 	cfgRoot->addChild( new config::CVarQString("Piece set", &pieceSetFile, config::CF_EDIT ) );
 
@@ -83,6 +86,20 @@ void MainWindow::initConfig()
 		QMessageBox::critical(0, "Error loading config", error );
 
 	cd->updateConfig();
+
+	if ( EngineStatsLog::isEnabled() )
+	{
+		QString statsName = EngineStatsLog::getFileName();
+		if ( QFileInfo( statsName ).isRelative() )
+			statsName = appRelative( statsName );
+		statsLog = new EngineStatsLog;
+		if ( !statsLog->open( statsName ) )
+		{
+			QMessageBox::critical(0, "Error opening engine stats log", statsName );
+			delete statsLog;
+			statsLog = 0;
+		}
+	}
 	
 	if ( mainWidth < defWidth )
 		mainWidth = defWidth;
@@ -122,7 +139,7 @@ MainWindow::MainWindow(const QString &appDir, QWidget *parent) :
 	QMainWindow(parent),
 	ui(new Ui::MainWindow),
 	rd(0), ed(0), cd(0), appDirectory(appDir),
-	cfgRoot(0), fontSize(-1), fontWeight(-1), fontBold(0), fontItalic(0),
+	cfgRoot(0), statsLog(0), fontSize(-1), fontWeight(-1), fontBold(0), fontItalic(0),
 	maxWindow(1), mainWidth(defWidth), mainHeight(defHeight)
 {
 	QLocale::setDefault(QLocale::C);
@@ -311,9 +328,19 @@ void MainWindow::frameWindowChanged()
 
 MainWindow::~MainWindow()
 {
+	// live frames (and their ingest threads) are destroyed after us, so detach the log first;
+	// setStatsLog waits for a PV being logged right now
+	QList<QMdiSubWindow *> windows = ui->mdiArea->subWindowList();
+	for ( int i=0; i<windows.size(); i++ )
+	{
+		LiveFrame *lf = qobject_cast<LiveFrame *>(windows[i]->widget());
+		if ( lf )
+			lf->setStatsLog( 0 );
+	}
 	delete ui;
 	delete pset;
 	delete cfgRoot;
+	delete statsLog;
 }
 
 void MainWindow::setStatusText( const QString &str )
@@ -345,6 +372,7 @@ LiveFrame *MainWindow::newConnection()
 			LiveFrame *child = new LiveFrame(this, pset, cd->getNick(), cd->getURL(), cd->getPort(), cd->getLayoutType() );
 			child->sigSetStatus.connect( this, &MainWindow::setStatusText );
 			child->sigMenuChanged.connect( this, &MainWindow::onMenuChanged );
+			child->setStatsLog( statsLog );
 			ui->mdiArea->addSubWindow(child);
 			res = child;
 			child->show();
@@ -604,6 +632,6 @@ void MainWindow::on_actionShowDebugConsole_triggered()
 	if ( !lf )
 		return;		// better safe than sorry
 	DebugConsoleDialog dlg( this );
-	dlg.setClient( lf->getClient() );
+	dlg.setIngest( lf->getIngest() );
 	dlg.exec();
 }
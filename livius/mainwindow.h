@@ -45,6 +45,7 @@ class LiveFrame;
 class ResultsDialog;
 class EmailGameDialog;
 class ConnectionDialog;
+class EngineStatsLog;
 
 class MainWindow : public QMainWindow
 {
@@ -157,6 +158,8 @@ private:
 	ConnectionDialog *cd;
 	QString appDirectory;
 	config::ConfigVarBase *cfgRoot;
+	// engine stats log (0 if disabled)
+	EngineStatsLog *statsLog;
 
 	// fonts (TODO: use struct instead)
 	QString fontFamily;
@@ -0,0 +1,85 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "movelistmodel.h"
+
+// MoveListModel
+
+MoveListModel::MoveListModel( const GameTimeline &timeline, QObject *parent )
+	: QAbstractListModel( parent )
+	, timeline( timeline )
+	, rows(0)
+{
+}
+
+// timeline was reset
+void MoveListModel::reset()
+{
+	beginResetModel();
+	sanCache.clear();
+	rows = 0;
+	endResetModel();
+	sync();
+}
+
+// moves were appended to timeline
+void MoveListModel::sync()
+{
+	int count = (int)timeline.size();
+	if ( count <= rows )
+		return;
+	beginInsertRows( QModelIndex(), rows, count-1 );
+	sanCache.resize( (size_t)count );
+	rows = count;
+	endInsertRows();
+}
+
+int MoveListModel::rowCount( const QModelIndex &parent ) const
+{
+	return parent.isValid() ? 0 : rows;
+}
+
+QVariant MoveListModel::data( const QModelIndex &index, int role ) const
+{
+	if ( !index.isValid() || index.row() < 0 || index.row() >= rows )
+		return QVariant();
+	if ( role == Qt::DisplayRole || role == Qt::ToolTipRole )
+		return getText( index.row() );
+	return QVariant();
+}
+
+const QString &MoveListModel::getText( int row ) const
+{
+	QString &res = sanCache[ (size_t)row ];
+	if ( res.isEmpty() )
+	{
+		// board before the move; replays at most GameTimeline::KEYFRAME_INTERVAL-1 moves
+		cheng4::Board b = timeline.boardAt( (size_t)row );
+		char buf[256];
+		*b.toSAN( buf, timeline.getMove( (size_t)row ) ) = 0;
+		res.sprintf( b.turn() == cheng4::ctWhite ? "%d. %s" : "%d... %s", (int)b.move(), buf );
+	}
+	return res;
+}
@@ -0,0 +1,60 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef MOVELISTMODEL_H
+#define MOVELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <vector>
+#include "gametimeline.h"
+
+// list model over moves of a GameTimeline
+// SAN text is computed on demand (only for rows actually displayed) and cached
+class MoveListModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	explicit MoveListModel( const GameTimeline &timeline, QObject *parent = 0 );
+
+	// timeline was reset
+	void reset();
+	// moves were appended to timeline
+	void sync();
+
+	int rowCount( const QModelIndex &parent = QModelIndex() ) const;
+	QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const;
+
+private:
+	const GameTimeline &timeline;
+	// number of rows published to views
+	int rows;
+	// lazy SAN cache (empty = not computed yet)
+	mutable std::vector< QString > sanCache;
+
+	const QString &getText( int row ) const;
+};
+
+#endif // MOVELISTMODEL_H
@@ -0,0 +1,174 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#include "movesequencer.h"
+#include "tlcvclient.h"
+#include <string.h>
+#include <stdlib.h>
+
+MoveSequencer::MoveSequencer() : lastAck(0), hasLastAck(0)
+{
+	memset( &stats, 0, sizeof(stats) );
+}
+
+const MoveSequencer::Stats &MoveSequencer::getStats() const
+{
+	return stats;
+}
+
+// number of pending moves
+size_t MoveSequencer::getPending() const
+{
+	return pending.size();
+}
+
+// clear pending moves and ack history (new game/disconnect)
+void MoveSequencer::clear()
+{
+	pending.clear();
+	lastAck = 0;
+	hasLastAck = 0;
+}
+
+// try to apply move text to board
+bool MoveSequencer::tryMove( cheng4::Board &board, int color, const char *c, Applied &res ) const
+{
+	if ( board.turn() != color )
+		return 0;
+	TLCVClient::skipSpc( c );
+	const char *beg = c;
+	// here comes move number (nn.)
+	TLCVClient::skipNonSpc( c );
+	double mnum = strtod( std::string( beg, c-beg ).c_str(), 0 );
+	TLCVClient::skipSpc( c );
+	// once we're in sequence, move number must match as well
+	// (a move from later in the game can be legal by accident)
+	if ( hasLastAck && mnum >= 1 && (cheng4::uint)mnum != board.move() )
+		return 0;
+
+	// here comes SAN move
+	cheng4::Move move = board.fromSAN(c);
+	if ( move == cheng4::mcNone )
+		return 0;
+
+	res.move = move;
+	res.moveNumber = (cheng4::uint)mnum;
+	board.setMove( res.moveNumber );
+	cheng4::UndoInfo ui;
+	board.doMove( move, ui, board.isCheck( move, board.discovered() ) );
+	if ( board.turn() == cheng4::ctWhite )
+		board.incMove();
+	return 1;
+}
+
+// mark ack as applied, drop older pending moves
+void MoveSequencer::setLastAck( AckType ack )
+{
+	lastAck = ack;
+	hasLastAck = 1;
+	stats.applied++;
+	// anything older is stale now
+	PendingMap::iterator it = pending.begin();
+	while ( it != pending.end() && it->first < ack )
+	{
+		stats.stale++;
+		pending.erase( it++ );
+	}
+}
+
+// apply pending moves that became applicable
+// note: a move can only become applicable after a move with lower ack, so one pass in ack order is enough
+void MoveSequencer::flush( cheng4::Board &board, std::vector< Applied > &applied )
+{
+	PendingMap::iterator it = pending.begin();
+	while ( it != pending.end() )
+	{
+		Applied a;
+		if ( !tryMove( board, it->second.color, it->second.text.constData(), a ) )
+		{
+			it++;
+			continue;
+		}
+		a.ack = it->first;
+		applied.push_back( a );
+		pending.erase( it );
+		// this drops everything before, so we continue right after the applied move
+		setLastAck( a.ack );
+		it = pending.begin();
+	}
+}
+
+// submit move command (nn. SAN)
+MoveSequencer::Result MoveSequencer::submit( cheng4::Board &board, AckType ack, int color, const char *text,
+	std::vector< Applied > &applied )
+{
+	if ( isStale( ack ) )
+	{
+		// older than what we already applied
+		stats.stale++;
+		return srStale;
+	}
+	Applied a;
+	if ( tryMove( board, color, text, a ) )
+	{
+		a.ack = ack;
+		applied.push_back( a );
+		setLastAck( ack );
+		flush( board, applied );
+		return srApplied;
+	}
+	// missing move(s) => keep pending until they arrive
+	Pending p;
+	p.color = color;
+	p.text = text;
+	pending[ack] = p;
+	stats.buffered++;
+	return srPending;
+}
+
+// resync point (server FEN with given ack)
+size_t MoveSequencer::resync( AckType ack )
+{
+	stats.resyncs++;
+	size_t dropped = 0;
+	PendingMap::iterator it = pending.begin();
+	while ( it != pending.end() && it->first < ack )
+	{
+		dropped++;
+		pending.erase( it++ );
+	}
+	stats.gaps += dropped;
+	// never move back, pending moves past lastAck must stay deliverable
+	if ( !hasLastAck || ack > lastAck )
+		lastAck = ack;
+	hasLastAck = 1;
+	return dropped;
+}
+
+// is ack older than last applied move?
+bool MoveSequencer::isStale( AckType ack ) const
+{
+	return hasLastAck && ack < lastAck;
+}
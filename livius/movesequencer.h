@@ -0,0 +1,117 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+#ifndef MOVESEQUENCER_H
+#define MOVESEQUENCER_H
+
+#include <QByteArray>
+#include <map>
+#include <vector>
+#include "chess/chess.h"
+#include "ack.h"
+
+// reassembles move commands in ack order
+// moves that don't apply yet are kept pending (ordered by ack) until the missing move arrives
+class MoveSequencer
+{
+public:
+	struct Applied
+	{
+		AckType ack;
+		cheng4::Move move;
+		// move number from command
+		cheng4::uint moveNumber;
+	};
+
+	struct Stats
+	{
+		// moves applied
+		quint64 applied;
+		// moves that had to wait for a missing move
+		quint64 buffered;
+		// moves dropped because a move with higher ack was already applied
+		quint64 stale;
+		// resyncs from server FEN
+		quint64 resyncs;
+		// pending moves that were never resolved (dropped at resync)
+		quint64 gaps;
+	};
+
+	enum Result
+	{
+		srApplied,		// move applied
+		srPending,		// move doesn't apply yet, waiting for missing move(s)
+		srStale			// move older than last applied move, dropped
+	};
+
+	MoveSequencer();
+
+	// submit move command (nn. SAN)
+	// applies it and then all pending moves that became applicable in a single forward pass
+	// applied moves are appended to applied
+	Result submit( cheng4::Board &board, AckType ack, int color, const char *text,
+		std::vector< Applied > &applied );
+
+	// apply pending moves that became applicable (single forward pass in ack order)
+	void flush( cheng4::Board &board, std::vector< Applied > &applied );
+
+	// resync point (server FEN with given ack)
+	// drops pending moves older than ack (counted as unresolved gaps)
+	// returns number of dropped moves
+	size_t resync( AckType ack );
+
+	// is ack older than last applied move?
+	bool isStale( AckType ack ) const;
+
+	// clear pending moves and ack history (new game/disconnect)
+	void clear();
+
+	// number of pending moves
+	size_t getPending() const;
+
+	const Stats &getStats() const;
+
+private:
+	struct Pending
+	{
+		int color;
+		QByteArray text;
+	};
+
+	typedef std::map< AckType, Pending > PendingMap;
+
+	PendingMap pending;
+	// last applied ack
+	AckType lastAck;
+	bool hasLastAck;
+	Stats stats;
+
+	// try to apply move text to board
+	bool tryMove( cheng4::Board &board, int color, const char *text, Applied &res ) const;
+	// mark ack as applied, drop older pending moves
+	void setLastAck( AckType ack );
+};
+
+#endif // MOVESEQUENCER_H
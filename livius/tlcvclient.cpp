@@ -109,10 +109,16 @@ void UDPClient::disconnect()
 
 // TLCVClient
 
-TLCVClient::TLCVClient( const QString &newNick ) : counter(1),
+TLCVClient::TLCVClient( const QString &newNick ) : shedCount(0), counter(1),
 	client(0), nick(newNick), logOn(0),
 	connecting(0), connPort(-1)
 {
+	for ( int i=0; i<SHED_MAX; i++ )
+	{
+		sheddable[i].stamp = 0;
+		sheddable[i].pending = 0;
+		sheddable[i].ack = 0;
+	}
 	client = new UDPClient;
 	client->sigReceive.connect( this, &TLCVClient::receive );
 }
@@ -159,6 +165,11 @@ void TLCVClient::disconnect()
 	connecting = 0;
 	queue.clear();
 	commands.clear();
+	for ( int i=0; i<SHED_MAX; i++ )
+	{
+		sheddable[i].pending = 0;
+		sheddable[i].text.clear();
+	}
 	sigDebugQueue(0);
 }
 
@@ -259,6 +270,7 @@ void TLCVClient::receive( const QByteArray &arr )
 	sigDebugReceive( arr );
 	receiveStamp = QDateTime::currentMSecsSinceEpoch();
 	updateBufferedCommands( receiveStamp );
+	updateSheddable( receiveStamp );
 	const char *c = arr.constData();
 	skipSpc(c);
 	AckType curId = 0;
@@ -386,25 +398,25 @@ void TLCVClient::receive( const QByteArray &arr )
 	if ( startsWith(c, "WPV:") )
 	{
 		skipSpc(c);
-		sigCommand( CMD_WPV, curId, c );
+		processSheddable( curId, CMD_WPV, c );
 		return;
 	}
 	if ( startsWith(c, "BPV:") )
 	{
 		skipSpc(c);
-		sigCommand( CMD_BPV, curId, c );
+		processSheddable( curId, CMD_BPV, c );
 		return;
 	}
 	if ( startsWith(c, "WTIME:") )
 	{
 		skipSpc(c);
-		sigCommand( CMD_WTIME, curId, c );
+		processSheddable( curId, CMD_WTIME, c );
 		return;
 	}
 	if ( startsWith(c, "BTIME:") )
 	{
 		skipSpc(c);
-		sigCommand( CMD_BTIME, curId, c );
+		processSheddable( curId, CMD_BTIME, c );
 		return;
 	}
 	if ( startsWith(c, "WMOVE:") )
@@ -503,6 +515,7 @@ void TLCVClient::refresh()
 		sendReliable("PING");
 	}
 	updateBufferedCommands( ms );
+	updateSheddable( ms );
 }
 
 // get crosstable command
@@ -536,3 +549,45 @@ void TLCVClient::updateBufferedCommands( qint64 stamp )
 		} else it++;
 	}
 }
+
+// deliver at most one PV/time update per side per this many ms; newer updates replace pending ones
+static const int shedInterval = 100;
+
+void TLCVClient::processSheddable( AckType ack, Command id, const char *text )
+{
+	SheddableCommand &sc = sheddable[ id - CMD_WPV ];
+	if ( !sc.pending && receiveStamp - sc.stamp >= shedInterval )
+	{
+		// below rate threshold => deliver now
+		sc.stamp = receiveStamp;
+		sigCommand( id, ack, text );
+		return;
+	}
+	// too fast => only keep newest
+	if ( sc.pending )
+		shedCount++;
+	sc.pending = 1;
+	sc.ack = ack;
+	sc.text = text;
+}
+
+void TLCVClient::updateSheddable( qint64 stamp )
+{
+	for ( int i=0; i<SHED_MAX; i++ )
+	{
+		SheddableCommand &sc = sheddable[i];
+		if ( !sc.pending || stamp - sc.stamp < shedInterval )
+			continue;
+		sc.stamp = stamp;
+		sc.pending = 0;
+		// note: copy because handler may reenter
+		std::string text = sc.text;
+		sigCommand( (Command)(CMD_WPV + i), sc.ack, text.c_str() );
+	}
+}
+
+// number of PV/time updates dropped by load shedding
+quint64 TLCVClient::getShedCount() const
+{
+	return shedCount;
+}
@@ -159,11 +159,17 @@ public:
 	// call this once a second
 	void refresh();
 
+	// number of PV/time updates dropped by load shedding
+	quint64 getShedCount() const;
+
 private:
 	void receive( const QByteArray &arr );
 	void gotACK( AckType id );
 	void processCommand( qint64 ack, Command id, const char *text );
 	void updateBufferedCommands( qint64 stamp );
+	// load shedding for PV/time updates (unreliable, only newest matters)
+	void processSheddable( AckType ack, Command id, const char *text );
+	void updateSheddable( qint64 stamp );
 
 	struct BufferedCommand
 	{
@@ -176,6 +182,24 @@ private:
 
 	BufferedCommands commands;
 
+	// sheddable commands: WPV, BPV, WTIME, BTIME
+	enum
+	{
+		SHED_MAX = CMD_BTIME - CMD_WPV + 1
+	};
+
+	struct SheddableCommand
+	{
+		qint64 stamp;		// timestamp (last delivered)
+		bool pending;		// have pending (newest) command
+		AckType ack;
+		std::string text;
+	};
+
+	SheddableCommand sheddable[ SHED_MAX ];
+	// number of dropped updates
+	quint64 shedCount;
+
 	struct ReliableMessage
 	{
 		AckType id;
@@ -0,0 +1,350 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+// livius-perft: movegen verification and benchmark
+//
+// usage: livius-perft [options]
+//   -fen <fen>      position to test (default: start position)
+//   -depth <n>      perft depth (default: 5)
+//   -epd <file>     run EPD perft suite (<fen> ;D1 20 ;D2 400 ...)
+//   -maxdepth <n>   limit EPD suite depth (default: all)
+//   -threads <n>    split root moves across n threads (default: 1)
+//   -hash <mb>      perft hash table size in MB (default: 0 = off)
+//   -divide         print node count per root move
+//   -nopext         use magic multiply slider attacks even if BMI2 pext is available
+
+#include "chess/chess.h"
+#include "chess/magic.h"
+#include "core/timer.h"
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cheng4;
+
+// lockless perft hash (entry is valid if lock ^ nodes == key)
+class PerftHash
+{
+	struct Entry
+	{
+		volatile u64 lock;
+		volatile u64 nodes;
+	};
+	std::vector< Entry > entries;
+	size_t mask;
+
+	static inline u64 makeKey( Signature sig, uint depth )
+	{
+		return sig ^ (U64C( 0x9e3779b97f4a7c15 ) * depth);
+	}
+public:
+	PerftHash() : mask(0) {}
+
+	void resize( size_t mb )
+	{
+		size_t count = 1;
+		while ( count * 2 * sizeof(Entry) <= mb * 1024 * 1024 )
+			count *= 2;
+		entries.clear();
+		Entry e = { 0, 0 };
+		entries.resize( mb ? count : 0, e );
+		mask = count - 1;
+	}
+
+	void clear()
+	{
+		for ( size_t i=0; i<entries.size(); i++ )
+			entries[i].lock = entries[i].nodes = 0;
+	}
+
+	inline bool enabled() const
+	{
+		return !entries.empty();
+	}
+
+	inline bool probe( Signature sig, uint depth, u64 &nodes ) const
+	{
+		u64 key = makeKey( sig, depth );
+		const Entry &e = entries[ (size_t)key & mask ];
+		u64 n = e.nodes;
+		if ( (e.lock ^ n) != key )
+			return 0;
+		nodes = n;
+		return 1;
+	}
+
+	inline void store( Signature sig, uint depth, u64 nodes )
+	{
+		u64 key = makeKey( sig, depth );
+		Entry &e = entries[ (size_t)key & mask ];
+		e.lock = key ^ nodes;
+		e.nodes = nodes;
+	}
+};
+
+static PerftHash hash;
+
+static u64 perft( Board &b, uint depth )
+{
+	Move moves[ maxMoves ];
+	MoveCount count = MoveGen::generateLegal( b, moves );
+	// bulk counting at leaves
+	if ( depth <= 1 )
+		return depth ? count : 1;
+
+	u64 nodes;
+	if ( hash.enabled() && hash.probe( b.sig(), depth, nodes ) )
+		return nodes;
+
+	nodes = 0;
+	Bitboard dc = b.discovered();
+	for ( MoveCount i=0; i<count; i++ )
+	{
+		UndoInfo ui;
+		b.doMove( moves[i], ui, b.isCheck( moves[i], dc ) );
+		nodes += perft( b, depth-1 );
+		b.undoMove( ui );
+	}
+	if ( hash.enabled() )
+		hash.store( b.sig(), depth, nodes );
+	return nodes;
+}
+
+// root split: workers take root moves one by one
+struct RootJob
+{
+	core::Mutex mutex;
+	const Board *board;
+	uint depth;
+	Move moves[ maxMoves ];
+	u64 nodes[ maxMoves ];
+	MoveCount count;
+	MoveCount next;
+};
+
+class PerftWorker : public core::Thread
+{
+	RootJob &job;
+public:
+	explicit PerftWorker( RootJob &job_ ) : job( job_ ) {}
+
+	void work()
+	{
+		Board b( *job.board );
+		Bitboard dc = b.discovered();
+		for (;;)
+		{
+			MoveCount i;
+			{
+				core::MutexLock lock( job.mutex );
+				if ( job.next >= job.count )
+					break;
+				i = job.next++;
+			}
+			UndoInfo ui;
+			b.doMove( job.moves[i], ui, b.isCheck( job.moves[i], dc ) );
+			job.nodes[i] = perft( b, job.depth-1 );
+			b.undoMove( ui );
+		}
+	}
+};
+
+static u64 perftRoot( const Board &b, uint depth, uint threads, bool divide )
+{
+	if ( depth <= 1 && !divide )
+	{
+		Board tb( b );
+		return perft( tb, depth );
+	}
+	RootJob job;
+	job.board = &b;
+	job.depth = depth;
+	job.count = MoveGen::generateLegal( b, job.moves );
+	job.next = 0;
+
+	std::vector< PerftWorker * > workers;
+	for ( uint i=0; i<threads; i++ )
+	{
+		workers.push_back( new PerftWorker( job ) );
+		workers.back()->run();
+	}
+	for ( size_t i=0; i<workers.size(); i++ )
+		workers[i]->kill();
+
+	u64 total = 0;
+	for ( MoveCount i=0; i<job.count; i++ )
+	{
+		total += job.nodes[i];
+		if ( divide )
+			printf( "%s: %llu\n", b.toSAN( job.moves[i] ).c_str(), (unsigned long long)job.nodes[i] );
+	}
+	return total;
+}
+
+struct Stats
+{
+	u64 nodes;
+	i32 ms;
+
+	Stats() : nodes(0), ms(0) {}
+};
+
+// run single perft and print result
+static u64 runPerft( const Board &b, uint depth, uint threads, bool divide, Stats &stats )
+{
+	hash.clear();
+	i32 start = core::Timer::getMillisec();
+	u64 nodes = perftRoot( b, depth, threads, divide );
+	i32 ms = core::Timer::getMillisec() - start;
+	stats.nodes += nodes;
+	stats.ms += ms;
+	printf( "depth %u: %llu nodes in %d ms (%.0f knps)\n", depth, (unsigned long long)nodes, (int)ms,
+		ms > 0 ? (double)nodes / ms : 0.0 );
+	return nodes;
+}
+
+// run EPD perft suite, returns number of failures
+static int runSuite( const char *fname, uint maxDepth, uint threads, Stats &stats )
+{
+	FILE *f = fopen( fname, "r" );
+	if ( !f )
+	{
+		fprintf( stderr, "can't open %s\n", fname );
+		return -1;
+	}
+	int failed = 0;
+	char line[ 1024 ];
+	while ( fgets( line, sizeof(line), f ) )
+	{
+		char *c = strchr( line, ';' );
+		if ( !c )
+			continue;
+		*c++ = 0;
+		Board b;
+		if ( !b.fromFEN( line ) )
+		{
+			fprintf( stderr, "invalid FEN: %s\n", line );
+			failed++;
+			continue;
+		}
+		printf( "%s\n", line );
+		// ;D<depth> <nodes>
+		while ( (c = strchr( c, 'D' )) != 0 )
+		{
+			char *end;
+			uint depth = (uint)strtoul( c+1, &end, 10 );
+			u64 expected = (u64)strtoull( end, &end, 10 );
+			c = end;
+			if ( maxDepth && depth > maxDepth )
+				break;
+			u64 nodes = runPerft( b, depth, threads, 0, stats );
+			if ( nodes != expected )
+			{
+				printf( "FAILED: expected %llu\n", (unsigned long long)expected );
+				failed++;
+			}
+		}
+	}
+	fclose( f );
+	return failed;
+}
+
+int main( int argc, char **argv )
+{
+	ChessInit init;
+	(void)init;
+
+	std::string fen;
+	const char *epd = 0;
+	uint depth = 5, maxDepth = 0, threads = 1;
+	size_t hashMB = 0;
+	bool divide = 0;
+
+	for ( int i=1; i<argc; i++ )
+	{
+		bool hasArg = i+1 < argc;
+		if ( !strcmp( argv[i], "-fen" ) && hasArg )
+			fen = argv[++i];
+		else if ( !strcmp( argv[i], "-depth" ) && hasArg )
+			depth = (uint)atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-epd" ) && hasArg )
+			epd = argv[++i];
+		else if ( !strcmp( argv[i], "-maxdepth" ) && hasArg )
+			maxDepth = (uint)atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-threads" ) && hasArg )
+			threads = (uint)atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-hash" ) && hasArg )
+			hashMB = (size_t)atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-divide" ) )
+			divide = 1;
+		else if ( !strcmp( argv[i], "-nopext" ) )
+			BitOp::disableHwPext();
+		else
+		{
+			fprintf( stderr, "usage: %s [-fen <fen>] [-depth <n>] [-epd <file>] [-maxdepth <n>] "
+				"[-threads <n>] [-hash <mb>] [-divide] [-nopext]\n", argv[0] );
+			return 1;
+		}
+	}
+	if ( divide && depth < 1 )
+	{
+		// divide counts subtrees of root moves
+		fprintf( stderr, "-divide needs depth 1 or more\n" );
+		return 1;
+	}
+	if ( threads < 1 )
+		threads = 1;
+	hash.resize( hashMB );
+
+#ifdef USE_PEXT
+	if ( BitOp::hasHwPext() && !Magic::verifyPext() )
+	{
+		fprintf( stderr, "pext attack tables don't match magic tables\n" );
+		return 1;
+	}
+#endif
+	printf( "slider attacks: %s\n", BitOp::hasHwPext() ? "pext" : "magic" );
+
+	Stats stats;
+	int failed = 0;
+	if ( epd )
+		failed = runSuite( epd, maxDepth, threads, stats );
+	else
+	{
+		Board b;
+		b.reset();
+		if ( !fen.empty() && !b.fromFEN( fen.c_str() ) )
+		{
+			fprintf( stderr, "invalid FEN: %s\n", fen.c_str() );
+			return 1;
+		}
+		runPerft( b, depth, threads, divide, stats );
+	}
+	printf( "total: %llu nodes in %d ms (%.0f knps)\n", (unsigned long long)stats.nodes, (int)stats.ms,
+		stats.ms > 0 ? (double)stats.nodes / stats.ms : 0.0 );
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# livius-perft: movegen verification and benchmark
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+include(../base/base.pri)
+DESTDIR = $$PWD
+
+TARGET = livius-perft
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+unix:LIBS += -lpthread
+
+SOURCES += main.cpp
@@ -0,0 +1,245 @@
+/*
+livius - a TLCV-compatible live chess viewer
+
+Copyright (c) 2014 Martin Sedlak (mar)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+   distribution.
+*/
+
+// livius-pgnbin: compact binary game archive converter
+//
+// usage: livius-pgnbin <command>
+//   -tobin <in.pgn> <out.lvg>   convert PGN to binary archive
+//   -topgn <in.lvg> <out.pgn>   convert binary archive to PGN
+//   -bench <in.pgn>             compare size and decode speed of PGN and binary archive
+
+#include "chess/chess.h"
+#include "pgn/pgn.h"
+#include "pgn/pgnbinary.h"
+#include <QFile>
+#include <QElapsedTimer>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+using namespace cheng4;
+
+// streams raw game text from an indexed PGN file
+// games are read straight from the mapped file; if the file isn't mapped, each game is loaded into a reused buffer
+class PGNSource
+{
+public:
+	bool open( const char *fname )
+	{
+		// one pass over the file => don't leave a persistent index next to it
+		pgn.setIndexCache( 0 );
+		if ( !pgn.load( QString::fromLocal8Bit( fname ) ) )
+		{
+			fprintf( stderr, "can't open %s\n", fname );
+			return 0;
+		}
+		pgn.wait();
+		return 1;
+	}
+
+	size_t getCount() const
+	{
+		return pgn.getCount();
+	}
+
+	// returns 0 on error
+	const char *getGame( size_t i, size_t &size )
+	{
+		PGNIndex idx;
+		if ( !pgn.getIndex( i, idx ) )
+			return 0;
+		size = idx.size;
+		if ( const char *text = pgn.rawData( idx.offset, idx.size ) )
+			return text;
+		// loadRawData appends a terminating zero
+		if ( !pgn.loadRawData( idx.offset, idx.size, buffer ) )
+			return 0;
+		return (const char *)&buffer.front();
+	}
+
+private:
+	PGNFile pgn;
+	std::vector< u8 > buffer;
+};
+
+// encode games, returns 0 if a game can't be read
+static bool encode( PGNSource &src, PGNBinaryWriter &writer, size_t &plies, size_t &bytes )
+{
+	plies = bytes = 0;
+	PGNBinaryGame game;
+	for ( size_t i=0; i<src.getCount(); i++ )
+	{
+		size_t size;
+		const char *text = src.getGame( i, size );
+		if ( !text )
+		{
+			fprintf( stderr, "can't read game %u\n", (uint)i+1 );
+			return 0;
+		}
+		bytes += size;
+		if ( !game.fromPGN( text, size ) )
+		{
+			fprintf( stderr, "skipping game %u (parse error)\n", (uint)i+1 );
+			continue;
+		}
+		if ( !writer.add( game ) )
+		{
+			fprintf( stderr, "skipping game %u (can't encode)\n", (uint)i+1 );
+			continue;
+		}
+		plies += game.moves.size();
+	}
+	return 1;
+}
+
+static int toBinary( const char *src, const char *dst )
+{
+	PGNSource pgn;
+	if ( !pgn.open( src ) )
+		return 1;
+	PGNBinaryWriter writer;
+	size_t plies, bytes;
+	if ( !encode( pgn, writer, plies, bytes ) )
+		return 1;
+	if ( !writer.save( QString::fromLocal8Bit( dst ) ) )
+	{
+		fprintf( stderr, "can't write %s\n", dst );
+		return 1;
+	}
+	printf( "%u games written\n", (uint)writer.getCount() );
+	return 0;
+}
+
+static int toPGN( const char *src, const char *dst )
+{
+	PGNBinaryReader reader;
+	if ( !reader.load( QString::fromLocal8Bit( src ) ) )
+	{
+		fprintf( stderr, "can't load %s\n", src );
+		return 1;
+	}
+	QFile f( QString::fromLocal8Bit( dst ) );
+	if ( !f.open( QFile::WriteOnly ) )
+	{
+		fprintf( stderr, "can't write %s\n", dst );
+		return 1;
+	}
+	PGNBinaryGame game;
+	for ( size_t i=0; i<reader.getCount(); i++ )
+	{
+		if ( !reader.getGame( i, game ) )
+		{
+			fprintf( stderr, "corrupt game %u\n", (uint)i+1 );
+			return 1;
+		}
+		QByteArray text = game.toPGN().toUtf8();
+		text += '\n';
+		if ( f.write( text.constData(), text.size() ) != text.size() )
+		{
+			fprintf( stderr, "can't write %s\n", dst );
+			return 1;
+		}
+	}
+	printf( "%u games written\n", (uint)reader.getCount() );
+	return 0;
+}
+
+static int bench( const char *src )
+{
+	PGNSource pgn;
+	if ( !pgn.open( src ) )
+		return 1;
+
+	PGNBinaryWriter writer;
+	size_t plies, pgnBytes;
+	if ( !encode( pgn, writer, plies, pgnBytes ) )
+		return 1;
+	std::vector< u8 > data;
+	writer.write( data );
+	PGNBinaryReader reader;
+	if ( !reader.setData( data ) )
+	{
+		fprintf( stderr, "binary archive self-check failed\n" );
+		return 1;
+	}
+
+	size_t games = writer.getCount();
+	if ( !games || !plies )
+	{
+		fprintf( stderr, "no games\n" );
+		return 1;
+	}
+
+	printf( "games: %u plies: %u\n", (uint)games, (uint)plies );
+	printf( "pgn:    %10u bytes %8.1f bytes/game %6.2f bytes/ply\n", (uint)pgnBytes,
+		(double)pgnBytes / games, (double)pgnBytes / plies );
+	printf( "binary: %10u bytes %8.1f bytes/game %6.2f bytes/ply\n", (uint)data.size(),
+		(double)data.size() / games, (double)data.size() / plies );
+
+	// decode speed: PGN parse vs binary replay (moves only, tags included in both)
+	PGNBinaryGame game;
+	QElapsedTimer timer;
+	timer.start();
+	size_t check = 0;
+	for ( size_t i=0; i<pgn.getCount(); i++ )
+	{
+		size_t size;
+		const char *text = pgn.getGame( i, size );
+		if ( text && game.fromPGN( text, size ) )
+			check += game.moves.size();
+	}
+	double pgnTime = (double)timer.nsecsElapsed();
+
+	timer.start();
+	for ( size_t i=0; i<reader.getCount(); i++ )
+		if ( reader.getGame( i, game ) )
+			check -= game.moves.size();
+	double binTime = (double)timer.nsecsElapsed();
+
+	printf( "decode pgn:    %8.1f ns/ply\n", pgnTime / plies );
+	printf( "decode binary: %8.1f ns/ply\n", binTime / plies );
+	if ( check )
+	{
+		fprintf( stderr, "decode mismatch\n" );
+		return 1;
+	}
+	return 0;
+}
+
+int main( int argc, char **argv )
+{
+	ChessInit init;
+	(void)init;
+
+	if ( argc == 4 && !strcmp( argv[1], "-tobin" ) )
+		return toBinary( argv[2], argv[3] );
+	if ( argc == 4 && !strcmp( argv[1], "-topgn" ) )
+		return toPGN( argv[2], argv[3] );
+	if ( argc == 3 && !strcmp( argv[1], "-bench" ) )
+		return bench( argv[2] );
+
+	fprintf( stderr, "usage: %s -tobin <in.pgn> <out.lvg> | -topgn <in.lvg> <out.pgn> | -bench <in.pgn>\n", argv[0] );
+	return 1;
+}
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# livius-pgnbin: binary game archive converter
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+include(../base/base.pri)
+DESTDIR = $$PWD
+
+TARGET = livius-pgnbin
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+unix:LIBS += -lpthread
+
+SOURCES += main.cpp